@@ -0,0 +1,269 @@
+/*GPL*START*
+ *
+ * compact binary log of check results
+ *
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/
+
+#include <string.h>
+#include "binlog.h"
+#include "tappconfig.h"
+
+// file format: a sequence of records, each a varint with the length of
+// the payload followed by the payload, which starts with a varint kind:
+// - log:   kind 1, "mp3check", format version
+// - file:  kind 2, name (varint length and bytes), size, flags (bit 0
+//          error, bit 1 anomaly, bit 2 vbr), frames + 1, duration in us,
+//          errors, anomalies, header, min, max and avg bitrate
+// - event: kind 3, type, frame + 1, time in us, offset + 1, count,
+//          expected and actual (zigzag encoded), flag
+// varints are little endian groups of 7 bits, bit 7 set on all but the last
+enum {REC_LOG = 1, REC_FILE = 2, REC_EVENT = 3};
+static const char *MAGIC = "mp3check";
+static const unsigned int FORMAT_VERSION = 1;
+static const unsigned int MAX_RECORD = 1 << 20;
+
+
+static void put_varint(tstring& buf, unsigned long long v) {
+   char b[10];
+   int n = 0;
+   while(v >= 0x80) {
+      b[n++] = (char)(v | 0x80);
+      v >>= 7;
+   }
+   b[n++] = (char)v;
+   buf.append(b, n);
+}
+
+static void put_signed(tstring& buf, long long v) {
+   put_varint(buf, ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+}
+
+static void put_string(tstring& buf, const tstring& s) {
+   put_varint(buf, s.len());
+   buf.append(s.c_str(), s.len());
+}
+
+static unsigned long long time_us(double ms) {
+   return (ms > 0.0) ? (unsigned long long)(ms * 1000.0 + 0.5) : 0;
+}
+
+// prefix payload with its length and append it to buf
+static void put_record(tstring& buf, const tstring& payload) {
+   put_varint(buf, payload.len());
+   buf += payload;
+}
+
+
+// payload of a record while decoding, ok is cleared on any overrun
+struct Payload {
+   Payload(const unsigned char *p_, size_t n_): p(p_), n(n_), ok(true) {}
+   const unsigned char *p;
+   size_t n;
+   bool ok;
+
+   unsigned long long varint() {
+      unsigned long long v = 0;
+      for(int shift = 0; shift < 64; shift += 7) {
+	 if(n == 0) break;
+	 unsigned char c = *p++;
+	 n--;
+	 v |= (unsigned long long)(c & 0x7f) << shift;
+	 if((c & 0x80) == 0) return v;
+      }
+      ok = false;
+      return 0;
+   }
+   long long signedVarint() {
+      unsigned long long v = varint();
+      return (long long)(v >> 1) ^ -(long long)(v & 1);
+   }
+   tstring string() {
+      unsigned long long l = varint();
+      if(l > n) {
+	 ok = false;
+	 return tstring();
+      }
+      tstring s((const char *)p, l);
+      p += l;
+      n -= l;
+      return s;
+   }
+};
+
+
+BinaryLog::BinaryLog(const tstring& fname_): fname(fname_) {
+   f = fopen(fname.c_str(), "ab");
+   if(f == 0)
+     userError("can't open binary log '%s' for writing!\n", fname.c_str());
+   pthread_mutex_init(&mutex, 0);
+   tstring payload, buf;
+   put_varint(payload, REC_LOG);
+   put_string(payload, MAGIC);
+   put_varint(payload, FORMAT_VERSION);
+   put_record(buf, payload);
+   write(buf);
+}
+
+
+BinaryLog::~BinaryLog() {
+   if(fclose(f))
+     userError("error while writing binary log '%s'!\n", fname.c_str());
+   pthread_mutex_destroy(&mutex);
+}
+
+
+void BinaryLog::encodeFile(tstring& buf, const File& file) {
+   const CheckSummary& s = file.sum;
+   tstring payload;
+   put_varint(payload, REC_FILE);
+   put_string(payload, file.name);
+   put_varint(payload, file.size);
+   put_varint(payload, (s.error ? 1 : 0) | (s.anomaly ? 2 : 0) | (s.vbr ? 4 : 0));
+   put_varint(payload, s.frames + 1);
+   put_varint(payload, time_us(s.time));
+   put_varint(payload, s.errors);
+   put_varint(payload, s.anomalies);
+   put_varint(payload, s.header);
+   put_varint(payload, s.min_bitrate);
+   put_varint(payload, s.max_bitrate);
+   put_varint(payload, s.avg_bitrate);
+   put_record(buf, payload);
+}
+
+
+void BinaryLog::encodeEvent(tstring& buf, const Event& e) {
+   tstring payload;
+   put_varint(payload, REC_EVENT);
+   put_varint(payload, e.type);
+   put_varint(payload, e.frame + 1);
+   put_varint(payload, time_us(e.time));
+   put_varint(payload, e.offset + 1);
+   put_signed(payload, e.count);
+   put_signed(payload, e.expected);
+   put_signed(payload, e.actual);
+   put_varint(payload, e.flag);
+   put_record(buf, payload);
+}
+
+
+void BinaryLog::write(const tstring& buf) {
+   pthread_mutex_lock(&mutex);
+   if(fwrite(buf.c_str(), 1, buf.len(), f) != buf.len())
+     userError("error while writing binary log '%s'!\n", fname.c_str());
+   pthread_mutex_unlock(&mutex);
+}
+
+
+BinaryLogReader::BinaryLogReader(const tstring& fname_): fname(fname_), pos(0) {
+   f = fopen(fname.c_str(), "rb");
+   if(f == 0)
+     userError("can't open binary log '%s' for reading!\n", fname.c_str());
+}
+
+
+BinaryLogReader::~BinaryLogReader() {
+   fclose(f);
+}
+
+
+static void not_binary_log(const tstring& fname) {
+   userError("'%s' is not a binary log of mp3check!\n", fname.c_str());
+}
+
+
+// decode the payload of a log, file or event record into file or e,
+// return false if it is corrupt
+static bool decode(const tstring& fname, unsigned long long kind, Payload& p, BinaryLog::File& file, Event& e) {
+   if(kind == REC_LOG) {
+      tstring magic = p.string();
+      unsigned long long version = p.varint();
+      if(!p.ok || (magic != MAGIC))
+	not_binary_log(fname);
+      if(version > FORMAT_VERSION)
+	userError("binary log '%s' has the unsupported format version %llu!\n", fname.c_str(), version);
+   } else if(kind == REC_FILE) {
+      CheckSummary& s = file.sum;
+      file.name = p.string();
+      file.size = p.varint();
+      unsigned long long flags = p.varint();
+      s.error = (flags & 1) != 0;
+      s.anomaly = (flags & 2) != 0;
+      s.vbr = (flags & 4) != 0;
+      s.frames = (int)p.varint() - 1;
+      s.time = p.varint() / 1000.0;
+      s.errors = p.varint();
+      s.anomalies = p.varint();
+      s.header = p.varint();
+      s.min_bitrate = p.varint();
+      s.max_bitrate = p.varint();
+      s.avg_bitrate = p.varint();
+   } else if(kind == REC_EVENT) {
+      e = Event(p.varint());
+      e.frame = (int)p.varint() - 1;
+      e.time = p.varint() / 1000.0;
+      e.offset = (off_t)p.varint() - 1;
+      e.count = p.signedVarint();
+      e.expected = p.signedVarint();
+      e.actual = p.signedVarint();
+      e.flag = p.varint() != 0;
+   }
+   // later versions may append fields, records of unknown kinds are skipped
+   return p.ok;
+}
+
+
+int BinaryLogReader::next(BinaryLog::File& file, Event& e) {
+   for(;;) {
+      // length of the payload
+      off_t start = pos;
+      bool first = (start == 0); // the first record must be a log record
+      unsigned long long len = 0;
+      int shift = 0;
+      int c;
+      while((c = getc(f)) != EOF) {
+	 pos++;
+	 len |= (unsigned long long)(c & 0x7f) << shift;
+	 shift += 7;
+	 if(((c & 0x80) == 0) || (shift >= 64)) break;
+      }
+      if(first && ((c == EOF) || (c & 0x80) || (len > MAX_RECORD)))
+	not_binary_log(fname);
+      if((c == EOF) && (pos == start)) return END;
+      if((c == EOF) || (c & 0x80) || (len > MAX_RECORD))
+	userError("corrupt binary log '%s' at offset %lld!\n", fname.c_str(), (long long)start);
+
+      // payload
+      unsigned char *buf = new unsigned char[len + 1];
+      if(fread(buf, 1, len, f) != len) {
+	 if(first) not_binary_log(fname);
+	 userError("binary log '%s' truncated at offset %lld!\n", fname.c_str(), (long long)start);
+      }
+      pos += len;
+      Payload p(buf, len);
+      unsigned long long kind = p.varint();
+      if(first && (!p.ok || (kind != REC_LOG)))
+	not_binary_log(fname);
+      bool ok = decode(fname, kind, p, file, e);
+      delete[] buf;
+      if(!ok)
+	userError("corrupt binary log '%s' at offset %lld!\n", fname.c_str(), (long long)start);
+      if(kind == REC_FILE)  return FILE_RECORD;
+      if(kind == REC_EVENT) return EVENT_RECORD;
+   }
+}
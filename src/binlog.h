@@ -0,0 +1,98 @@
+/*GPL*START*
+ *
+ * compact binary log of check results header file
+ *
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/
+
+#ifndef _binlog_h_
+#define _binlog_h_
+
+#include <stdio.h>
+#include <pthread.h>
+#include "tstring.h"
+#include "report.h"
+
+// 2026:
+// 16 Oct  started: append only, varint encoded, readable on every host
+// 16 Oct  a log must start with a log record
+
+
+// append only log of the results of -e and -a: one file record (name,
+// size and summary) followed by the events of the file
+// all numbers are varints, so logs are small and independent of the
+// byte order; each log (and each run appending to it) starts with a log
+// record, so logs can be merged by simply concatenating them
+class BinaryLog {
+ public:
+   // result of one file
+   struct File {
+      File(): size(0) {}
+      tstring name;
+      off_t size;
+      CheckSummary sum;
+   };
+
+   // open fname for appending
+   BinaryLog(const tstring& fname);
+   ~BinaryLog();
+
+   // append the record of file f and its events to buf
+   static void encodeFile(tstring& buf, const File& f);
+   static void encodeEvent(tstring& buf, const Event& e);
+
+   // write the records in buf in one piece (thread safe)
+   void write(const tstring& buf);
+
+ private:
+   // forbid copy
+   BinaryLog(const BinaryLog&);
+   const BinaryLog& operator=(const BinaryLog&);
+
+   tstring fname;
+   FILE *f;
+   pthread_mutex_t mutex;
+};
+
+
+// sequential reader of a binary log
+class BinaryLogReader {
+ public:
+   enum {END, FILE_RECORD, EVENT_RECORD};
+
+   // open fname for reading
+   BinaryLogReader(const tstring& fname);
+   ~BinaryLogReader();
+
+   // read the next file or event record into f or e, return its kind
+   // or END at the end of the log (records of unknown kinds are skipped)
+   // files which do not start with a log record are rejected
+   int next(BinaryLog::File& f, Event& e);
+
+ private:
+   // forbid copy
+   BinaryLogReader(const BinaryLogReader&);
+   const BinaryLogReader& operator=(const BinaryLogReader&);
+
+   tstring fname;
+   FILE *f;
+   off_t pos;  // position of the current record
+};
+
+
+#endif
@@ -23,7 +23,7 @@
 #include "crc16.h"
 
 // create crc engine and reset to 0 (build shift table)
-CRC16::CRC16(unsigned int polynom): c(0)
+CRC16::CRC16(unsigned int polynom): c(0), poly(polynom)
 {
    for(unsigned int i = 0; i < 256; ++i)
    {
@@ -31,6 +31,35 @@ CRC16::CRC16(unsigned int polynom): c(0)
       for(int j=0; j < 8; ++j, x <<= 1)
 	if(x & 0x10000)
 	  x ^= polynom;
-      tab[i] = x>>1;
+      tab[0][i] = x>>1;
+   }
+   for(unsigned int i = 0; i < 256; ++i)
+     for(int k = 1; k < 8; ++k)
+       tab[k][i] = tab[0][tab[k-1][i]>>8] ^ (tab[k-1][i]<<8);
+}
+
+
+// add n bytes: 8 bytes at a time with one lookup per byte, but without
+// the dependency of each lookup on the previous one
+void CRC16::add(const unsigned char *p, size_t n)
+{
+   unsigned int x = c;
+   for(; n >= 8; n -= 8, p += 8)
+     x = tab[7][p[0]^(x>>8)] ^ tab[6][p[1]^(x&0xff)] ^ tab[5][p[2]] ^ tab[4][p[3]] ^
+         tab[3][p[4]] ^ tab[2][p[5]] ^ tab[1][p[6]] ^ tab[0][p[7]];
+   for(; n; --n, ++p)
+     x = tab[0][(x>>8)^*p] ^ ((x<<8)&0xffff);
+   c = x;
+}
+
+
+// add the n most significant bits of b, one bit at a time
+void CRC16::add_bits(unsigned char b, int n)
+{
+   for(int i = 0; i < n; ++i, b <<= 1)
+   {
+      bool x = ((c >> 15) ^ (b >> 7)) & 1;
+      c <<= 1;
+      if(x) c ^= poly;
    }
 }
@@ -34,6 +34,12 @@
 // 26 Feb 00:00 Khali added file crc16.cc for better code structure
 // 26 Feb 00:00 reset(), add() and crc() made inline again for speed reasons
 
+// 2026:
+// 16 Oct  add() for blocks: slicing by 8 bytes
+// 16 Oct  add_bits() for crcs not ending on a byte boundary
+
+
+#include <stddef.h>
 
 class CRC16 {
  public:
@@ -51,15 +57,22 @@ class CRC16 {
    void reset(unsigned short init = 0) { c = init; }
    
    // add 8 bits
-   void add(unsigned char b) { c = tab[(c>>8)^b] ^ (c<<8); }
+   void add(unsigned char b) { c = tab[0][(c>>8)^b] ^ (c<<8); }
+   
+   // add n bytes
+   void add(const unsigned char *p, size_t n);
+   
+   // add the n (0..8) most significant bits of b
+   void add_bits(unsigned char b, int n);
    
    // get current crc value
    unsigned short crc() const { return c; }
    
  private:            
    // private data
-   unsigned short tab[256];  // shift table
+   unsigned short tab[8][256];  // shift tables: tab[k][b] is the crc of b followed by k zero bytes
    unsigned short c;         // current crc value
+   unsigned short poly;      // generator polynom without x^16
 };
 
 
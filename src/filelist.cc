@@ -0,0 +1,235 @@
+/*GPL*START*
+ *
+ * list of the files to check
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <algorithm>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
+#include "filelist.h"
+#include "tappconfig.h"
+
+// default value for systems which do not define O_BINARY
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+
+FileList::FileList(const tvector<tstring>& params_, bool recursive_, bool cross_filesystems, int dir_threads_, const tstring& listfile_,
+		   const tvector<tstring>& accept_, const tvector<tstring>& reject_, Order order_):
+params(params_), param(0), walker(0), listfile(0), recursive(recursive_), context(cross_filesystems), dir_threads(dir_threads_), 
+order(order_), base(0), head(0), produced(false), end(false) {
+   if(!listfile_.empty()) {
+      listfile = fopen(listfile_.c_str(), "r");
+      if(listfile == 0)
+	userError("cannot open file '%s' for reading!\n", listfile_.c_str());
+   }
+   for(size_t i = 0; i < accept_.size(); i++)
+     accept[accept_[i]] = 1;
+   for(size_t i = 0; i < reject_.size(); i++)
+     reject[reject_[i]] = 1;
+   pthread_mutex_init(&mutex, 0);
+}
+
+
+FileList::~FileList() {
+   delete walker;
+   if(listfile) fclose(listfile);
+   pthread_mutex_destroy(&mutex);
+}
+
+
+bool FileList::produce(FileName& file) {
+   tstring& name = file.name;
+   file.stated = false;
+   for(;;) {
+      // files of a directory
+      if(walker) {
+	 if(walker->next(name, file.stated, file.st)) return true;
+	 delete walker;
+	 walker = 0;
+      }
+      
+      // command line
+      if(param < params.size()) {
+	 name = params[param++];
+	 if(recursive) {
+	    try {
+	       TFile f(name);
+	       if(f.isdir()) {
+		  walker = new TDirWalker(f, context, dir_threads);
+		  continue;
+	       }
+	    }
+	    catch(...) {}
+	 }
+	 return true;
+      }
+      
+      // --filelist
+      if(listfile) {
+	 if(name.readLine(listfile)) return true;
+	 fclose(listfile);
+	 listfile = 0;
+      }
+      return false;
+   }
+}
+
+
+bool FileList::wanted(const tstring& name) const {
+   tstring e = name;
+   e.extractFilenameExtension();
+   return (accept.empty() || accept.contains(e)) && !reject.contains(e);
+}
+
+
+// sort key of a file
+struct SortKey {
+   mydev_t device;
+   unsigned long long position;
+   ino_t inode;
+   size_t index;   // keeps the given order of equal keys
+};
+static bool operator<(const SortKey& a, const SortKey& b) {
+   if(a.device != b.device) return a.device < b.device;
+   if(a.position != b.position) return a.position < b.position;
+   if(a.inode != b.inode) return a.inode < b.inode;
+   return a.index < b.index;
+}
+
+
+// physical position of the first extent of a regular file, 0 if unknown
+static unsigned long long first_extent(const char *name) {
+#if defined(__linux__) && defined(FS_IOC_FIEMAP)
+   int fd = open(name, O_RDONLY | O_BINARY);
+   if(fd == -1) return 0;
+   union {
+      struct fiemap map;
+      char buf[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+   } fm;
+   memset(&fm, 0, sizeof(fm));
+   fm.map.fm_length = FIEMAP_MAX_OFFSET;
+   fm.map.fm_extent_count = 1;
+   unsigned long long r = 0;
+   if((ioctl(fd, FS_IOC_FIEMAP, &fm.map) == 0) && (fm.map.fm_mapped_extents > 0))
+     r = fm.map.fm_extents[0].fe_physical;
+   close(fd);
+   return r;
+#else
+   (void)name;
+   return 0;
+#endif
+}
+
+
+void FileList::sortBatch() {
+   // collect a batch, the files are stat'ed here instead of by the check
+   tvector<FileName> batch;
+   tvector<SortKey> keys;
+   while((batch.size() < SORT_BATCH) && !produced) {
+      FileName f;
+      if(!produce(f)) {
+	 produced = true;
+	 break;
+      }
+      if(!wanted(f.name)) continue;
+      if(!f.stated && (f.name != "-") && (stat(f.name.c_str(), &f.st) == 0))
+	f.stated = true;
+      SortKey k;
+      memset(&k, 0, sizeof(k));
+      k.index = batch.size();
+      if(f.stated) {
+	 k.device = dev_t2mydev_t(f.st.st_dev);
+	 k.inode = f.st.st_ino;
+	 switch(order) {
+	  case SIZE:
+	    k.device = 0;
+	    k.inode = 0;
+	    k.position = f.st.st_size;
+	    break;
+	  case EXTENT:
+	    // files without extents (empty or inline) go first, by inode
+	    if(S_ISREG(f.st.st_mode)) k.position = first_extent(f.name.c_str());
+	    break;
+	  default:
+	    break;
+	 }
+      }
+      batch.push_back(f);
+      keys.push_back(k);
+   }
+   std::sort(keys.begin(), keys.end());
+   for(size_t j = 0; j < keys.size(); j++)
+     window.push_back(batch[keys[j].index]);
+}
+
+
+bool FileList::get(size_t i, FileName& file) {
+   pthread_mutex_lock(&mutex);
+   assert(i >= base);
+   while(!end && (i >= base + window.size() - head)) {
+      if(order != GIVEN) {
+	 sortBatch();
+	 end = produced;
+	 continue;
+      }
+      FileName f;
+      if(!produce(f)) end = true;
+      else if(wanted(f.name)) window.push_back(f);
+   }
+   bool r = i < base + window.size() - head;
+   if(r) file = window[head + i - base];
+   pthread_mutex_unlock(&mutex);
+   return r;
+}
+
+
+void FileList::forget(size_t i) {
+   pthread_mutex_lock(&mutex);
+   if(i > base) {
+      size_t n = i - base;
+      if(n > window.size() - head) n = window.size() - head;
+      head += n;
+      base += n;
+      // remove the forgotten files in bulk: erasing each from the front
+      // would be quadratic in the size of a sorted batch
+      if((head >= FORGET_BULK) && (head * 2 >= window.size())) {
+	 window.erase(window.begin(), window.begin() + head);
+	 head = 0;
+      }
+   }
+   pthread_mutex_unlock(&mutex);
+}
+
+
+size_t FileList::count() {
+   pthread_mutex_lock(&mutex);
+   size_t r = base + window.size() - head;
+   pthread_mutex_unlock(&mutex);
+   return r;
+}
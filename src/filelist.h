@@ -0,0 +1,106 @@
+/*GPL*START*
+ *
+ * list of the files to check header file
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#ifndef _filelist_h_
+#define _filelist_h_
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "tstring.h"
+#include "tvector.h"
+#include "tmap.h"
+#include "tfiletools.h"
+
+// 2026:
+// 16 Oct  started
+// 16 Oct  pass on the status of the files known from the walk
+// 16 Oct  read directories ahead with threads
+// 16 Oct  --sort
+
+
+// a file to check
+struct FileName {
+   FileName(): stated(false) {}
+   tstring name;
+   bool stated;      // st is known from walking the directory (or sorting)
+   struct stat st;
+};
+
+
+// the files to check: the command line parameters (directories walked
+// recursively with --recursive) followed by the lines of the --filelist file,
+// filtered by --accept and --reject while walking
+// names are produced when they are first asked for and only kept until they
+// are forgotten, so the memory usage does not depend on the number of files
+// and the check of the first file starts at once
+// the files may be sorted by their physical order on the disk to save seeks,
+// this is done in batches of SORT_BATCH files to keep the memory bounded
+class FileList {
+ public:
+   enum Order {GIVEN, INODE, EXTENT, SIZE};
+   enum {SORT_BATCH = 65536, FORGET_BULK = 1024};
+   
+   // dir_threads: threads reading the directories ahead (see TDirWalker)
+   FileList(const tvector<tstring>& params, bool recursive, bool cross_filesystems, int dir_threads, const tstring& listfile,
+	    const tvector<tstring>& accept, const tvector<tstring>& reject, Order order);
+   ~FileList();
+   
+   // get file i, return false if there are only i files
+   // (thread safe, i must not be forgotten)
+   bool get(size_t i, FileName& file);
+   // the names of the files before i are not needed any more
+   void forget(size_t i);
+   // number of files found so far (all files once get() returned false)
+   size_t count();
+   
+ private:
+   // forbid copy
+   FileList(const FileList&);
+   const FileList& operator=(const FileList&);
+   
+   // get the next file before filtering, return false at the end
+   bool produce(FileName& file);
+   bool wanted(const tstring& name) const;
+   // append the next batch of files in the order of order to the window
+   void sortBatch();
+   
+   tvector<tstring> params;
+   size_t param;             // next command line parameter
+   TDirWalker *walker;       // walking a directory of the command line
+   FILE *listfile;           // --filelist, 0 if none or at its end
+   bool recursive;
+   TSubTreeContext context;
+   int dir_threads;
+   tmap<tstring,int> accept; // extensions, all if empty
+   tmap<tstring,int> reject;
+   Order order;
+   tvector<FileName> window; // files base, base + 1, ... from window[head] on
+   size_t base;
+   size_t head;              // number of forgotten files at the start of window
+   bool produced;            // produce() is at the end
+   bool end;                 // all files found
+   pthread_mutex_t mutex;    // protects all of the above
+};
+
+
+#endif
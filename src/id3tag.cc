@@ -65,9 +65,9 @@ bool Tagv1::spacefilled_tag_field(const char *p, const unsigned int len)
 }
 
 // Returns next position of an id3 v1 tag, or -1 if not found.
-int Tagv1::find_next_tag(const unsigned char *p, int len)
+off_t Tagv1::find_next_tag(const unsigned char *p, off_t len)
 {
-	int i;
+	off_t i;
 	Tagv1* tag;
 
 	tag=new Tagv1();
@@ -48,6 +48,8 @@
 #ifndef _id3tag_h_
 #define _id3tag_h_
 
+#include <sys/types.h>
+
 class Tagv1
 {
 
@@ -77,7 +79,7 @@ public:
 	// Static functions.
 	static bool valid_tag_field_strict(const unsigned char *p, const int len);
 	static bool valid_tag_field_loose(const unsigned char *p, const int len);
-	static int find_next_tag(const unsigned char *p, int len);
+	static off_t find_next_tag(const unsigned char *p, off_t len);
 	static void copyStringField(char *dest, const unsigned char *src, int len);
 	unsigned short int fields_version;
 	bool fields_spacefilled;
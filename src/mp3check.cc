@@ -26,9 +26,18 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "tappconfig.h"
 #include "crc16.h"
 #include "id3tag.h"
+#include "syncscan.h"
+#include "streamwindow.h"
+#include "resultcache.h"
+#include "readahead.h"
+#include "pagecache.h"
+#include "filelist.h"
+#include "report.h"
+#include "binlog.h"
 #include "tfiletools.h"
 
 
@@ -53,6 +62,7 @@ const char *options[] = {
      "emphasis (n=none, 5=50/15 usecs, J=CCITT J.17), COY (has [C]rc, [O]riginal, cop[Y]right), length [min:sec], filename (poss. truncated)'",
    "name=error-check      , type=switch, char=e, help='check crc and headers for consistency and print several error messages'",
    "name=max-errors       , type=int   , char=m, param=N, lower=0, help='with -e: set maximum number of errors N to print per file (default 0==infinity)'",
+   "name=verdict-only     , type=switch,         help='check like -e, but print nothing and only return the exit status: stop checking a file at its first error (after ignoring errors) and stop at the first erroneous file'",
    "name=anomaly-check    , type=switch, char=a, help='report all differences from these parameters: layer 3, 44.1kHz, 128kB, joint stereo, no emphasis, has crc'",
    "name=dump-header      , type=switch, char=d, help='dump all possible header with sync=0xfff'",
    "name=dump-tag         , type=switch, char=t, help='dump all possible tags of known version'",
@@ -95,11 +105,18 @@ const char *options[] = {
 #ifndef __CYGWIN__
    "name=xdev             , type=switch,         help='do not descend into other filesystems when recursing directories'",
 #endif
+   "name=all-links        , type=switch,         help='check every path of a file with several hard links (by default a file is checked once, its other paths report \'same as <first path>\', only with -e and -a)'",
+   "name=dir-threads      , type=int   ,       , param=N, lower=0, default=0, help='read directories with N threads ahead of the check (with --recursive, for file systems with a high latency like NFS)'",
+   "name=sort             , type=string,       , param=ORDER, default=none, help='check the files sorted by inode, extent (position on the disk) or size instead of in the given order (none), to save seeks on hard disks (in batches of 65536 files)'",
+   "name=read-binary-log  , type=switch,         help='print the binary logs (see --binary-log) given as FILES like -e and -a printed the results (with --verbose also the stream parameters), or as --format'",
    "name=print-files      , type=switch,         help='just print all filenames without processing them, then exit (for debugging purposes, also useful to create files for --filelist)'",
      
    "name=single-line      , type=switch, char=s, help='print one line per file and message instead of splitting into several lines', headline='output options:'",
    "name=no-summary       , type=switch,       , help='suppress the summary printed below all messages if multiple files are given'",
+   "name=format           , type=string,       , param=FORMAT, default=text, help='output format of -e and -a: text or ndjson (one json record per message and a summary record per file)'",
    "name=log-file         , type=string, char=g, param=FILE, help='print names of erroneous files to FILE, one per line'",
+   "name=binary-log       , type=string,       , param=FILE, help='append the results of -e and -a to FILE in a compact binary format (stream parameters and all messages, see --read-binary-log)'",
+   "name=cache            , type=string,       , param=FILE, help='remember the results of -e and -a in FILE and report them again for unchanged files instead of checking them'",
    "name=quiet            , type=switch, char=q, help='quiet mode, hide messages about directories, non-regular or non-existing files'",
    "name=color            , type=switch, char=o, help='colorize output with ANSI sequences'",
    "name=alt-color        , type=switch, char=b, help='colorize: do not use bold ANSI sequences'",
@@ -107,6 +124,10 @@ const char *options[] = {
    "name=progress         , type=switch, char=p, help='show progress information on stderr'", 
    "name=verbose          , type=switch, char=v, help='be more verbose'",
    "name=no-mmap          , type=switch,       , help='do not use mmap (e.g. when you get \\'mmap: No such device\\')'",
+   "name=stream           , type=switch,       , help='read files through a small sliding window instead of mapping them completely (memory usage independent of the file size), only with -e and -a'",
+   "name=jobs             , type=int   , char=j, param=N, lower=1, default=1, help='check N files in parallel and split large files into up to N segments for -e (not together with options which modify files, except with --dummy)'",
+   "name=cache-policy     , type=string,       , param=LIST, help='page cache hints, comma separated: sequential (read ahead aggressively), willneed (read each file at once), populate (map files with all pages read), drop (remove the pages read by the check from the page cache again, e.g. for background checks)'",
+   "name=read-ahead       , type=int   ,       , param=N, lower=0, default=0, help='read up to N files ahead of the check with N threads, so slow disks and network file systems always have N requests queued (files up to 64MB, only with -e and -a)'",
    "name=dummy            , type=switch, char=0, help='do not write/modify anything other than the logfile', headline=common options:",
    "EOL" // end of list     
 };
@@ -144,6 +165,17 @@ const char *c_nor = "\033[0m";
 // minimum number of sequential valid and constant frame headers to validate header
 const int MIN_VALID = 6;
 const int LIST_MAX_HEADER_SEARCH = 1024*1024; // search max 1MB for --list --compact-list --raw-list
+const int JOB_WINDOW = 4; // --jobs: number of files per thread which may be checked ahead of the output
+const size_t MAX_FILE_OUTPUT = 64*1024; // --jobs: max bytes of buffered output per file
+const int MAX_FRAME_LENGTH = 1729; // mpeg 1 layer 2, 384kbit/s, 32kHz, padding
+const int FRAME_LOOKAHEAD = 64; // bytes needed at the start of a frame (header, crc and side info)
+const int HEADER_SEARCH_MARGIN = MIN_VALID*MAX_FRAME_LENGTH + 4; // lookahead of find_next_header()
+const size_t STREAM_WINDOW_SIZE = 1024*1024; // --stream: size of the sliding window
+const size_t LIST_WINDOW_SIZE = 64*1024; // --list: size of the window for head and tail
+const size_t MAX_LINK_RESULTS = 64*1024; // results of files with several hard links kept for their other paths
+const off_t SEGMENT_MIN_SIZE = 64*1024*1024; // --jobs: large files are checked in segments of at least this size
+const size_t MAX_SEGMENT_MESSAGES = 100000; // --jobs: a segment with more messages is left to the sequential check
+const size_t MAX_PENDING_EVENTS = 1024; // events recorded per file before they are formatted
 
 // global data
 bool progress = false;
@@ -154,6 +186,26 @@ unsigned int columns = 0;
 bool show_valid_files = false;
 bool quiet = false;
 bool only_ascii = false;
+bool nommap = false;
+bool stream = false;
+ResultCache *cache = 0;
+BinaryLog *binary_log = 0;
+ReadAhead *read_ahead = 0;
+bool dedup_links = false;
+bool verdict_only = false;
+// --cache-policy
+enum {PAGES_SEQUENTIAL = 1, PAGES_WILLNEED = 2, PAGES_POPULATE = 4, PAGES_DROP = 8};
+int cache_policy = 0;
+// --format
+enum {FORMAT_TEXT, FORMAT_NDJSON};
+int output_format = FORMAT_TEXT;
+int jobs = 1;
+char rawsep = '\t';
+char rawlinesep = '\n';
+bool edit_frame_byte = false;
+int efb_value = 0;
+int efb_offset = 0;
+int efb_frame = 0;
 
 bool ano_any_crc   = false;
 bool ano_any_bit   = false;
@@ -385,6 +437,14 @@ inline Header get_header(const unsigned char *p) {
 }
 
 
+// get header from integer (as returned by Header::get_int())
+inline Header int_header(unsigned int i) {
+   Header h;
+   memcpy(&h, &i, sizeof(h));
+   return h;
+}
+
+
 // set header to pointer
 inline void set_header(unsigned char *p, Header h) {
    unsigned char *q = (unsigned char *)&h;
@@ -429,8 +489,8 @@ inline bool set_crc_value(unsigned char *p, unsigned short c) {
 }
 
 
-// return length of frame in bytes
-inline int frame_length(Header h) {
+// calculate length of frame in bytes (use frame_length())
+int calc_frame_length(Header h) {
    if(h.version() == 1.0) {
       switch(h.layer()) {
        case 1:
@@ -441,47 +501,194 @@ inline int frame_length(Header h) {
    } else {  
       switch(h.layer()) {
        case 1:
-	 return (((6000*h.bitrate()) / h.samp_int_rate()) + h.padding_bit) * 4;
-       default:
+	 return (((12000*h.bitrate()) / h.samp_int_rate()) + h.padding_bit) * 4;
+       case 2:            // 1152 samples per frame as in mpeg 1.0
+	 return ((144000*h.bitrate()) / h.samp_int_rate()) + h.padding_bit;
+       default:           // layer 3 has only 576 samples per frame
 	 return ((72000*h.bitrate()) / h.samp_int_rate()) + h.padding_bit;
       }
    }
 }
 
+
+// calculate length of side info in bytes (use sideinfo_length())
+// (0 == unknown or variable, see layer2_crc_bits())
+int calc_sideinfo_length(Header h) {
+   if(h.layer()==1) {     // layer 1, the same for all versions: 4 bit allocation per subband
+      switch(h.mode) {
+       case Header::SINGLE_CHANNEL: return 16;
+       case Header::DUAL_CHANNEL:   return 32;
+       case Header::STEREO:         return 32;
+       case Header::JOINT_STEREO:   return 18+h.mode_extension*2;
+      }
+      return 0;
+   }
+   if(h.version()==1.0) { // mpeg 1.0
+      switch(h.layer()) { 
+       case 3:            // layer 3
+	 if(h.mode==Header::SINGLE_CHANNEL) return 17;
+	 else return 32;
+	 
+       default:
+	 return 0; // mpeg 1.0 layer 2: depends on the bit allocation
+      } 
+   } else {               // mpeg 2.0 or 2.5
+      if(h.layer()==3) {  // layer 3
+	 if(h.mode==Header::SINGLE_CHANNEL) return 9; 
+	 else return 17;
+      } else {
+	 return 0; // mpeg 2.0 or 2.5 layer 2: depends on the bit allocation
+      }
+   }
+}
+
+
+// decode tables: all per frame calculations are done once in init_frame_tab()
+struct FrameInfo {
+   int length;       // frame length in bytes, 0 == invalid (reserved/forbidden values, free format)
+   double duration;  // frame duration in ms
+};
+// indexed by header bits 19..9: ID, layer, protection, bitrate, sampling frequency, padding
+const int FRAME_TAB_SHIFT = 9;
+const unsigned int FRAME_TAB_MASK = 0x7ff;
+FrameInfo frame_tab[FRAME_TAB_MASK + 1];
+// indexed by header bits 19..17 and 7..4: ID, layer, mode, mode extension
+unsigned char sideinfo_tab[128];
+
+inline unsigned int sideinfo_index(unsigned int i) {return ((i >> 13) & 0x70) | ((i >> 4) & 0xf);}
+
+void init_frame_tab() {
+   for(unsigned int k = 0; k <= FRAME_TAB_MASK; k++) {
+      Header h = int_header(0xfff00000 | (k << FRAME_TAB_SHIFT));
+      FrameInfo& f = frame_tab[k];
+      f.length = 0;
+      f.duration = 0.0;
+      if((h.layer_index == 0) || (h.bitrate_index == 15) || (h.sampling_frequency == 3)) continue;
+      int l = calc_frame_length(h);
+      if(l < 21) continue;  // free format or too short
+      f.length = l;
+      f.duration = ((double)l*8) / h.bitrate();
+   }
+   for(unsigned int k = 0; k < 128; k++) {
+      Header h = int_header(0xfff00000 | ((k & 0x70) << 13) | ((k & 0xf) << 4));
+      sideinfo_tab[k] = h.layer_index ? calc_sideinfo_length(h) : 0;
+   }
+}
+
+
+// return length of frame in bytes (0 for invalid headers)
+inline int frame_length(Header h) {
+   return frame_tab[(h.get_int() >> FRAME_TAB_SHIFT) & FRAME_TAB_MASK].length;
+}
+
 					 
 // return duration of frame in ms
 inline double frame_duration(Header h) {
-   return (((double)frame_length(h)*8) / h.bitrate());
+   return frame_tab[(h.get_int() >> FRAME_TAB_SHIFT) & FRAME_TAB_MASK].duration;
+}
+
+
+// return length of side info in bytes (0 == crc not supported)
+inline int sideinfo_length(Header h) {
+   return sideinfo_tab[sideinfo_index(h.get_int())];
+}
+
+
+// layer 2 bit allocation tables: number of allocation bits per subband
+// (ISO 11172-3 tables B.2a-d, ISO 13818-3 table B.1 for the lower sampling frequencies)
+const int LAYER2_TABLES = 5;
+const int layer2_sblimit[LAYER2_TABLES] = {27, 30, 8, 12, 30};
+const unsigned char layer2_nbal[LAYER2_TABLES][32] = {
+   {4,4,4,4,4,4,4,4,4,4,4,3,3,3,3,3,3,3,3,3,3,3,3,2,2,2,2},
+   {4,4,4,4,4,4,4,4,4,4,4,3,3,3,3,3,3,3,3,3,3,3,3,2,2,2,2,2,2,2},
+   {4,4,3,3,3,3,3,3},
+   {4,4,3,3,3,3,3,3,3,3,3,3},
+   {4,4,4,4,3,3,3,3,3,3,3,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2}
+};
+// maximum number of bytes protected by the crc in a layer 2 frame
+// (2 channels with 94 allocation bits and 30 scfsi fields each)
+const int LAYER2_MAX_CRC_LENGTH = (2*94 + 2*30*2 + 7) / 8;
+
+
+// select the bit allocation table of a layer 2 frame
+inline int layer2_table(Header h) {
+   if(h.version() != 1.0) return 4;
+   int ch_bitrate = h.bitrate() / ((h.mode == Header::SINGLE_CHANNEL) ? 1 : 2);
+   int freq = h.samp_int_rate();
+   if(((freq == 48000) && (ch_bitrate >= 56)) || ((ch_bitrate >= 56) && (ch_bitrate <= 80))) return 0;
+   if((freq != 48000) && (ch_bitrate >= 96)) return 1;
+   if((freq != 32000) && (ch_bitrate <= 48)) return 2;
+   return 3;
+}
+
+
+// return the n bits (n <= 8) at bit position pos and advance pos
+inline unsigned int get_bits(const unsigned char *p, int& pos, int n) {
+   unsigned int x = (p[pos >> 3] << 8) | p[(pos >> 3) + 1];
+   x = (x >> (16 - (pos & 7) - n)) & ((1 << n) - 1);
+   pos += n;
+   return x;
+}
+
+
+// return the number of bits protected by the crc in a layer 2 frame:
+// bit allocation and scale factor selection information (p points behind the crc)
+// up to LAYER2_MAX_CRC_LENGTH+1 bytes are read
+int layer2_crc_bits(Header h, const unsigned char *p) {
+   int t = layer2_table(h);
+   int sblimit = layer2_sblimit[t];
+   const unsigned char *nbal = layer2_nbal[t];
+   int nch = (h.mode == Header::SINGLE_CHANNEL) ? 1 : 2;
+   int bound = (h.mode == Header::JOINT_STEREO) ? (h.mode_extension+1)*4 : sblimit;
+   if(bound > sblimit) bound = sblimit;
+   int pos = 0;
+   int scfsi = 0;  // number of scfsi fields (one per channel and subband with allocation)
+   for(int sb = 0; sb < bound; sb++)
+     for(int ch = 0; ch < nch; ch++)
+       if(get_bits(p, pos, nbal[sb])) scfsi++;
+   for(int sb = bound; sb < sblimit; sb++) // intensity stereo: allocation shared by both channels
+     if(get_bits(p, pos, nbal[sb])) scfsi += nch;
+   return pos + scfsi*2;
+}
+
+
+// return true if h is a valid header of a frame with known length
+// (same as h.isValid() && (frame_length(h) >= 21))
+inline bool valid_frame(Header h) {
+   unsigned int i = h.get_int();
+   return ((i & 0xfff00000) == 0xfff00000) && ((i & 3) != 2) && frame_tab[(i >> FRAME_TAB_SHIFT) & FRAME_TAB_MASK].length;
 }
 
 
 // return next pos of min_valid sequential valid and constant header 
 // or -1 if not found
-inline int find_next_header(const unsigned char *p, int len, int min_valid) {
-   int i;
+inline off_t find_next_header(const unsigned char *p, off_t len, int min_valid) {
+   off_t i;
    const unsigned char *q = p;
    const unsigned char *t;   
-   int rest, k, l;
+   off_t rest;
+   int k, l;
    Header h, h2;
    
-   for(i=0; i < len-3; i++, q++) {
-      if(*q==255) {
-	 h = get_header(q);
+   for(i=0; i < len-3; i++) {
+      // skip to the next possible sync word
+      i += find_sync_candidate(p + i, len - 3 - i);
+      if(i >= len-3) break;
+      q = p + i;
+      h = get_header(q);
+      if(valid_frame(h)) {
 	 l = frame_length(h);
-	 if(h.isValid() && (l>=21)) {
-	    t = q + l;
-	    rest = len - i - l;
-	    for(k=1; (k < min_valid) && (rest >= 4); k++) {
-	       h2 = get_header(t);
-	       if(!h2.isValid()) break;
-	       if(!h2.sameConstant(h)) break;
-	       l = frame_length(h2);
-	       if(l < 21) break;
-	       t += l;
-	       rest -= l;
-	    }
-	    if(k == min_valid) return i;
+	 t = q + l;
+	 rest = len - i - l;
+	 for(k=1; (k < min_valid) && (rest >= 4); k++) {
+	    h2 = get_header(t);
+	    if(!valid_frame(h2)) break;
+	    if(!h2.sameConstant(h)) break;
+	    l = frame_length(h2);
+	    t += l;
+	    rest -= l;
 	 }
+	 if(k == min_valid) return i;
       }
    }
    
@@ -489,10 +696,10 @@ inline int find_next_header(const unsigned char *p, int len, int min_valid) {
 }
 
 // return pointer to beginning of nth frame from start (0 is start) or 0 if frame not found
-const unsigned char *skip_n_frames(const unsigned char *start, int len, int n) {
+const unsigned char *skip_n_frames(const unsigned char *start, off_t len, int n) {
    while(1) {
       // skip invalid data
-      int s = find_next_header(start, len, MIN_VALID);
+      off_t s = find_next_header(start, len, MIN_VALID);
       if(s < 0) return 0;
       start += s;
       len -= s;
@@ -500,7 +707,7 @@ const unsigned char *skip_n_frames(const unsigned char *start, int len, int n) {
       while(1) {
 	 if(len < 4) return 0;
 	 h = get_header(start);
-	 if(h.isValid()) {
+	 if(valid_frame(h)) {
 	    if(n <= 0) return start;
 	    int l = frame_length(h);
 	    start += l;
@@ -514,73 +721,956 @@ const unsigned char *skip_n_frames(const unsigned char *start, int len, int n) {
 }
 
 
+// find_next_header() on the data of a window: return offset relative to pos
+// of the next min_valid sequential valid and constant headers in [pos,end)
+// or -1 if not found
+off_t find_next_header(StreamWindow& in, off_t pos, off_t end, int min_valid) {
+   off_t from = pos;
+   while(1) {
+      off_t avail;
+      off_t n = end - from;
+      if(n > 2*HEADER_SEARCH_MARGIN) n = 2*HEADER_SEARCH_MARGIN;
+      const unsigned char *p = in.data(from, n, avail);
+      if(end > in.length()) end = in.length();
+      if(avail > end - from) avail = end - from;
+      off_t s = find_next_header(p, avail, min_valid);
+      if(s >= 0) return from - pos + s;
+      if((from + avail >= end) || (avail <= HEADER_SEARCH_MARGIN)) return -1;
+      // no sequence starts before the last HEADER_SEARCH_MARGIN bytes of the window
+      from += avail - HEADER_SEARCH_MARGIN;
+   }
+}
+
+// Tagv1::find_next_tag() on the data of a window: return offset relative
+// to pos of the next tag in [pos,end) or -1 if not found
+off_t find_next_tag(StreamWindow& in, off_t pos, off_t end) {
+   off_t from = pos;
+   while(1) {
+      off_t avail;
+      off_t n = end - from;
+      if(n > 2*HEADER_SEARCH_MARGIN) n = 2*HEADER_SEARCH_MARGIN;
+      const unsigned char *p = in.data(from, n, avail);
+      if(end > in.length()) end = in.length();
+      if(avail > end - from) avail = end - from;
+      off_t s = Tagv1::find_next_tag(p, avail);
+      if(s >= 0) return from - pos + s;
+      if((from + avail >= end) || (avail < 128)) return -1;
+      // tags must fit completely into the window
+      from += avail - 127;
+   }
+}
+
+
+// per thread output buffer: all messages of one file are collected here 
+// and printed in one piece; when checking files in parallel (--jobs) the
+// files are printed in the order of the file list
+struct JobQueue;
+struct FileOutput {
+   FileOutput(): queue(0), index(0) {}
+   tstring text;          // formatted messages
+   tvector<Event> events; // events behind text, formatted when needed
+   tstring eventname;     // name of the file of the events
+   tstring lastname;      // name of the file of the last message
+   tstring rawname;       // name of the file of pname and shortname
+   tstring pname;         // rawname with unprintable chars replaced
+   tstring shortname;     // pname shortened to the terminal width
+   JobQueue *queue;       // reorder buffer of this output (0 == print directly)
+   size_t index;          // index of the file in the file list
+};
+__thread FileOutput *file_output = 0;
+FileOutput stdout_output;  // output of the main thread without --jobs
+void flush_file_output(FileOutput& out);
+void format_events(FileOutput& out);
+
+// output buffer of the current thread
+inline FileOutput& current_output() {
+   return file_output ? *file_output : stdout_output;
+}
+
+// --cache: copy of all messages of the file currently checked by this thread
+__thread tstring *file_capture = 0;
+
+// --binary-log: encoded events of the file currently checked by this thread
+__thread tstring *file_events = 0;
+
+
 #ifdef __GNUC__
+void mprintf(const char *format, ...) __attribute__ ((format(printf,1,2)));
 void fmes(const char *name, const char *format, ...) __attribute__ ((format(printf,2,3)));
 #endif
 
+// print to the output buffer of the current thread
+void vmprintf(const char *format, va_list ap) {
+   FileOutput& out = current_output();
+   if(!out.events.empty()) format_events(out);
+   char buf[1024];
+   char *p = buf;
+   va_list aq;
+   va_copy(aq, ap);
+   int n = vsnprintf(buf, sizeof(buf), format, aq);
+   va_end(aq);
+   if(n >= (int)sizeof(buf)) {
+      // long message (e.g. cached messages of a whole file)
+      if(vasprintf(&p, format, ap) < 0) return;
+   }
+   if(n > 0) {
+      if(file_capture) file_capture->append(p, n);
+      out.text.append(p, n);
+   }
+   if(p != buf) free(p);
+   if(out.text.len() > MAX_FILE_OUTPUT) flush_file_output(out);
+}
+
+void mprintf(const char *format, ...) {
+   va_list ap;
+   va_start(ap, format);
+   vmprintf(format, ap);
+   va_end(ap);
+}
+
 void fmes(const char *name, const char *format, ...) {
    if(quiet) return;
    va_list ap;
-   static tstring lastname;
-   tstring pname = name;
-   pname.replaceUnprintable(only_ascii);
+   if(output_format == FORMAT_NDJSON) {
+      // messages which are not events: one record with the plain text
+      char *buf;
+      va_start(ap, format);
+      int n = vasprintf(&buf, format, ap);
+      va_end(ap);
+      if(n < 0) return;
+      if((n > 0) && (buf[n - 1] == '\n')) buf[n - 1] = 0;
+      tstring r = "{\"file\":" + json_string(name) + ",\"type\":\"message\",\"text\":" + json_string(buf) + "}\n";
+      free(buf);
+      mprintf("%s", r.c_str());
+      return;
+   }
+   FileOutput& out = current_output();
+   if(!out.events.empty()) format_events(out);
+   if(out.rawname != name) {
+      // sanitize each file name only once
+      out.rawname = name;
+      out.pname = name;
+      out.pname.replaceUnprintable(only_ascii);
+      out.shortname = out.pname.shortFilename(columns-1);
+   }
    
    if(progress) putc('\r', stderr);
    if(strcmp(format, "\n") == 0) {
-      printf("%s%s%s:\n", cfil, pname.c_str(), cnor);
+      mprintf("%s%s%s:\n", cfil, out.pname.c_str(), cnor);
       return;
    }     
    if(single_line) {
-      printf("%s%s%s: ", cfil, pname.c_str(), cnor);
+      mprintf("%s%s%s: ", cfil, out.pname.c_str(), cnor);
    } else {
-      if(name != lastname) {
-	 lastname = name;	 
-	 tstring s = pname.shortFilename(columns-1);
-	 printf("%s%s%s:\n", cfil, s.c_str(), cnor);	 
+      if(name != out.lastname) {
+	 out.lastname = name;	 
+	 mprintf("%s%s%s:\n", cfil, out.shortname.c_str(), cnor);	 
       }
    }
    va_start(ap, format);
-   vprintf(format, ap);
+   vmprintf(format, ap);
    va_end(ap);
+   // keep the messages in step with the progress line on stderr
+   if(progress) flush_file_output(out);
+}
+
+
+// print the output of the main thread (at the end of each file)
+void flush_stdout_output() {
+   format_events(stdout_output);
+   fwrite(stdout_output.text.c_str(), 1, stdout_output.text.len(), stdout);
+   stdout_output.text.clear();
+}
+
+
+// --jobs: events about the frames of one segment of a large file, with
+// frame numbers and times relative to the start of the segment
+__thread tvector<Event> *segment_events = 0;
+
+
+// event about the frame at offset
+inline Event frame_event(int type, int frame, double time, off_t offset) {
+   Event e(type);
+   e.frame = frame;
+   e.time = time;
+   e.offset = offset;
+   return e;
+}
+
+
+// print one line about the frame of event e (continuation without file name)
+void print_frame_line(const Event& e, const char *text) {
+   mprintf("frame %s%5d%s/%s%2u:%02u%s: %s",
+	   cval, e.frame, cnor,
+	   cval, (unsigned int)(e.time/1000)/60, (unsigned int)(e.time/1000)%60, cnor, text);
+}
+
+
+// print event e as text
+void print_event_text(const char *name, const Event& e) {
+   char buf[1024];
+   Header h = int_header(e.actual);
+   switch(e.type) {
+    case Event::NOT_MPEG:
+      snprintf(buf, sizeof(buf), "%snot an audio mpeg stream%s\n", cerror, cnor);
+      break;
+    case Event::EMPTY_FILE:
+      snprintf(buf, sizeof(buf), "%sempty file%s\n", cerror, cnor);
+      break;
+    case Event::JUNK_START:
+      snprintf(buf, sizeof(buf), "%s%lld%s %sbyte%s of junk before first frame header%s\n", 
+	       cval, e.count, cnor, cerror, (e.count>1)?"s":"", cnor);
+      break;
+    case Event::TAG_IN_JUNK_START:
+    case Event::TAG_IN_JUNK_END:
+      snprintf(buf, sizeof(buf), "in %s junk: %spossible %s id3 tag v%u.%u%s at %s0x%08llx%s\n",
+	       (e.type == Event::TAG_IN_JUNK_START) ? "leading" : "trailing",
+	       cerror, e.flag?"valid":"invalid",
+	       (unsigned int)(e.actual>>8), (unsigned int)(e.actual&0xff), cnor,
+	       cval, (unsigned long long)e.offset, cnor);
+      break;
+    case Event::TAG_TRAILER:
+      snprintf(buf, sizeof(buf), "%s%s%s id3 tag trailer v%u.%u found%s\n", 
+	       cerror, (e.count>1?"another ":""), e.flag?"valid":"invalid",
+	       (unsigned int)(e.actual>>8), (unsigned int)(e.actual&0xff), cnor);
+      break;
+    case Event::SYNC_SHORT:
+      snprintf(buf, sizeof(buf), "%ssync error (frame too short)%s at %s0x%08llx%s, %s%d%s byte%s mising\n",
+	       cerror, cnor, cval, (unsigned long long)e.offset, cnor,
+	       cval, int(e.expected-e.actual), cnor, (e.expected-e.actual>1)?"s":"");
+      break;
+    case Event::SYNC_LONG:
+      snprintf(buf, sizeof(buf), "%ssync error (frame too long)%s at %s0x%08llx%s, skipping %s%lld%s byte%s at %s0x%08llx%s\n",
+	       cerror, cnor, cval, (unsigned long long)e.offset, cnor,
+	       cval, e.actual-e.expected, cnor, (e.actual-e.expected>1)?"s":"",
+	       cval, (unsigned long long)(e.offset + e.expected), cnor);
+      break;
+    case Event::FIX_SYNC:
+      snprintf(buf, sizeof(buf), "%sfixing header (including sync)%s\n", cerror, cnor);
+      break;
+    case Event::CONSTANT_SWITCH:
+      snprintf(buf, sizeof(buf), "%sconstant parameter switching%s at %s0x%08llx%s (%s0x%08x%s -> %s0x%08x%s)\n",
+	       cerror, cnor,
+	       cval, (unsigned long long)e.offset, cnor,
+	       cval, (unsigned int)e.expected&CONST_MASK, cnor,
+	       cval, (unsigned int)e.actual&CONST_MASK, cnor);
+      break;
+    case Event::FIX_HEADER:
+      snprintf(buf, sizeof(buf), "%sfixing header%s\n", cerror, cnor);
+      break;
+    case Event::BITRATE_SWITCH:
+      snprintf(buf, sizeof(buf), "%sbitrate switching%s (%s%d%s -> %s%d%s)\n",
+	       cerror, cnor, 
+	       cval, int(e.expected), cnor,
+	       cval, int(e.actual), cnor);
+      break;
+    case Event::CRC_ERROR:
+      snprintf(buf, sizeof(buf), "%scrc error%s (%s0x%04x%s!=%s0x%04x%s)%s\n",
+	       cerror, cnor, 
+	       cval, (unsigned int)e.actual, cnor, cval, (unsigned int)e.expected, cnor, e.flag ? " fixed" : "");
+      break;
+    case Event::MAX_ERRORS:
+      snprintf(buf, sizeof(buf), "%smaximum number of errors exceeded%s\n", cerror, cnor);
+      break;
+    case Event::TRUNCATED:
+      snprintf(buf, sizeof(buf), "%sfile truncated%s, %s%lld%s byte%s missing for last frame\n",
+	       cerror, cnor, cval, e.count, cnor, (e.count>1)?"s":"");
+      break;
+    case Event::JUNK_END:
+      snprintf(buf, sizeof(buf), "%s%lld%s %sbyte%s of junk after last frame%s at %s0x%08llx%s\n",
+	       cval, e.count, cnor, cerror, (e.count>1)?"s":"", cnor, cval, (unsigned long long)e.offset, cnor);
+      break;
+    case Event::VALID:
+      snprintf(buf, sizeof(buf), "%svalid audio mpeg stream%s\n", cok, cnor);
+      break;
+    case Event::ANOMALY_VERSION:
+      snprintf(buf, sizeof(buf), "%sanomaly%s: audio mpeg version %s%3.1f%s stream\n", 
+	       cano, cnor, cval, h.version(), cnor);
+      break;
+    case Event::ANOMALY_LAYER:
+      snprintf(buf, sizeof(buf), "%sanomaly%s: audio mpeg %slayer %d%s stream\n", 
+	       cano, cnor, cval, h.layer(), cnor);
+      break;
+    case Event::ANOMALY_SAMPLING:
+      snprintf(buf, sizeof(buf), "%sanomaly%s: sampling rate %s%4.1fkHz%s\n", 
+	       cano, cnor, cval, h.samp_rate(), cnor);
+      break;
+    case Event::ANOMALY_BITRATE:
+      snprintf(buf, sizeof(buf), "%sanomaly%s: bitrate %s%3dkbit/s%s\n", 
+	       cano, cnor, cval, h.bitrate(), cnor);
+      break;
+    case Event::ANOMALY_MODE:
+      snprintf(buf, sizeof(buf), "%sanomaly%s: mode %s%s%s\n", 
+	       cano, cnor, cval, h.mode_str(), cnor);
+      break;
+    case Event::ANOMALY_CRC:
+      snprintf(buf, sizeof(buf), "%sanomaly%s: %sno crc%s\n", 
+	       cano, cnor, cval, cnor);
+      break;
+    case Event::ANOMALY_EMPHASIS:
+      snprintf(buf, sizeof(buf), "%sanomaly%s: emphasis %s%s%s\n", 
+	       cano, cnor, cval, h.emphasis_str(), cnor);
+      break;
+    default:
+      snprintf(buf, sizeof(buf), "%s%s%s\n", cerror, Event::name(e.type), cnor);
+   }
+   if(e.frame < 0) {
+      fmes(name, "%s", buf);
+      return;
+   }
+   fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %s",
+	cval, e.frame, cnor,
+	cval, (unsigned int)(e.time/1000)/60, (unsigned int)(e.time/1000)%60, cnor, buf);
+   
+   // constant parameter switching: one line per parameter
+   if(e.type != Event::CONSTANT_SWITCH) return;
+   Header head = int_header(e.expected);
+   if(h.ID!=head.ID) {
+      snprintf(buf, sizeof(buf), "  %sMPEG version switching%s (MPEG %s%1.1f%s -> MPEG %s%1.1f%s)\n",
+	       cerror, cnor,
+	       cval, head.version(), cnor,
+	       cval, h.version(), cnor);
+      print_frame_line(e, buf);
+   }
+   if(h.layer_index!=head.layer_index) {
+      snprintf(buf, sizeof(buf), "  %sMPEG layer switching%s (layer %s%1d%s -> layer %s%1d%s)\n",
+	       cerror, cnor,
+	       cval, head.layer(), cnor,
+	       cval, h.layer(), cnor);
+      print_frame_line(e, buf);
+   }
+   if(h.samp_rate()!=head.samp_rate()) {
+      snprintf(buf, sizeof(buf), "  %ssampling frequency switching%s (%s%f%skHz -> %s%f%skHz)\n",
+	       cerror, cnor,
+	       cval, head.samp_rate(), cnor,
+	       cval, h.samp_rate(), cnor);
+      print_frame_line(e, buf);
+   }
+   if(h.mode!=head.mode) {
+      snprintf(buf, sizeof(buf), "  %smode switching%s (%s%s%s -> %s%s%s)\n",
+	       cerror, cnor,
+	       cval, head.mode_str(), cnor,
+	       cval, h.mode_str(), cnor);
+      print_frame_line(e, buf);
+   }
+   if(h.protection_bit!=head.protection_bit) {
+      snprintf(buf, sizeof(buf), "  %sprotection bit switching%s (%s%s%s -> %s%s%s)\n",
+	       cerror, cnor,
+	       cval, head.protection_bit?"no crc":"crc", cnor,
+	       cval, h.protection_bit?"no crc":"crc", cnor);
+      print_frame_line(e, buf);
+   }
+   if(h.copyright!=head.copyright) {
+      snprintf(buf, sizeof(buf), "  %scopyright bit switching%s (%s%s%s -> %s%s%s)\n",
+	       cerror, cnor,
+	       cval, head.copyright?"copyright":"no copyright", cnor,
+	       cval, h.copyright?"copyright":"no copyright", cnor);
+      print_frame_line(e, buf);
+   }
+   if(h.original!=head.original) {
+      snprintf(buf, sizeof(buf), "  %soriginal bit switching%s (%s%s%s -> %s%s%s)\n",
+	       cerror, cnor,
+	       cval, head.original?"original":"not original", cnor,
+	       cval, h.original?"original":"not original", cnor);
+      print_frame_line(e, buf);
+   }
+}
+
+
+// names of the modes and emphases in structured output
+const char *json_mode[4] = {"stereo", "joint stereo", "dual channel", "single channel"};
+const char *json_emphasis[4] = {"none", "50/15us", "reserved", "ccitt j.17"};
+
+
+// print event e as one json record (--format=ndjson)
+void print_event_json(const char *name, const Event& e) {
+   char buf[256];
+   Header h = int_header(e.actual);
+   tstring r = "{\"file\":" + json_string(name) + ",\"type\":\"" + Event::name(e.type) + "\"";
+   if(e.frame >= 0) {
+      snprintf(buf, sizeof(buf), ",\"frame\":%d,\"time_ms\":%.3f", e.frame, e.time);
+      r += buf;
+   }
+   if(e.offset >= 0) {
+      snprintf(buf, sizeof(buf), ",\"offset\":%lld", (long long)e.offset);
+      r += buf;
+   }
+   buf[0] = 0;
+   switch(e.type) {
+    case Event::NOT_MPEG:
+      snprintf(buf, sizeof(buf), ",\"size\":%lld", e.count);
+      break;
+    case Event::JUNK_START:
+    case Event::JUNK_END:
+      snprintf(buf, sizeof(buf), ",\"bytes\":%lld", e.count);
+      break;
+    case Event::TRUNCATED:
+      snprintf(buf, sizeof(buf), ",\"missing\":%lld", e.count);
+      break;
+    case Event::TAG_TRAILER:
+    case Event::TAG_IN_JUNK_START:
+    case Event::TAG_IN_JUNK_END:
+      snprintf(buf, sizeof(buf), ",\"version\":\"%u.%u\",\"valid\":%s",
+	       (unsigned int)(e.actual>>8), (unsigned int)(e.actual&0xff), e.flag?"true":"false");
+      if(e.type == Event::TAG_TRAILER) {
+	 r += buf;
+	 snprintf(buf, sizeof(buf), ",\"number\":%lld", e.count);
+      }
+      break;
+    case Event::SYNC_SHORT:
+    case Event::SYNC_LONG:
+    case Event::BITRATE_SWITCH:
+      snprintf(buf, sizeof(buf), ",\"expected\":%lld,\"actual\":%lld", e.expected, e.actual);
+      break;
+    case Event::CRC_ERROR:
+      snprintf(buf, sizeof(buf), ",\"expected\":%lld,\"actual\":%lld,\"fixed\":%s", e.expected, e.actual, e.flag?"true":"false");
+      break;
+    case Event::CONSTANT_SWITCH: {
+       Header head = int_header(e.expected);
+       snprintf(buf, sizeof(buf), ",\"expected\":%lld,\"actual\":%lld,\"changed\":[", e.expected, e.actual);
+       r += buf;
+       tstring changed;
+       if(h.ID!=head.ID)                         changed += ",\"version\"";
+       if(h.layer_index!=head.layer_index)       changed += ",\"layer\"";
+       if(h.samp_rate()!=head.samp_rate())       changed += ",\"sampling\"";
+       if(h.mode!=head.mode)                     changed += ",\"mode\"";
+       if(h.protection_bit!=head.protection_bit) changed += ",\"protection\"";
+       if(h.copyright!=head.copyright)           changed += ",\"copyright\"";
+       if(h.original!=head.original)             changed += ",\"original\"";
+       if(!changed.empty()) r += changed.c_str() + 1;
+       snprintf(buf, sizeof(buf), "]");
+       break;
+    }
+    case Event::ANOMALY_VERSION:
+      snprintf(buf, sizeof(buf), ",\"expected\":1.0,\"actual\":%.1f", h.version());
+      break;
+    case Event::ANOMALY_LAYER:
+      snprintf(buf, sizeof(buf), ",\"expected\":3,\"actual\":%d", h.layer());
+      break;
+    case Event::ANOMALY_SAMPLING:
+      snprintf(buf, sizeof(buf), ",\"expected\":44.1,\"actual\":%g", h.samp_rate());
+      break;
+    case Event::ANOMALY_BITRATE:
+      snprintf(buf, sizeof(buf), ",\"expected\":128,\"actual\":%d", h.bitrate());
+      break;
+    case Event::ANOMALY_MODE:
+      snprintf(buf, sizeof(buf), ",\"expected\":\"joint stereo\",\"actual\":\"%s\"", json_mode[h.mode]);
+      break;
+    case Event::ANOMALY_CRC:
+      snprintf(buf, sizeof(buf), ",\"expected\":true,\"actual\":false");
+      break;
+    case Event::ANOMALY_EMPHASIS:
+      snprintf(buf, sizeof(buf), ",\"expected\":\"none\",\"actual\":\"%s\"", json_emphasis[h.emphasis]);
+      break;
+   }
+   r += buf;
+   r += "}\n";
+   mprintf("%s", r.c_str());
+}
+
+
+// record (or collect for a segment) event e about file name: the event is
+// formatted only when the output of the file is printed
+void report(const char *name, const Event& e) {
+   if(segment_events) {
+      *segment_events += e;
+      return;
+   }
+   if(file_events) BinaryLog::encodeEvent(*file_events, e);
+   if(quiet) return;
+   FileOutput& out = current_output();
+   if(!out.events.empty() && (out.eventname != name)) format_events(out);
+   if(out.events.empty()) out.eventname = name;
+   out.events += e;
+   if(progress || (out.events.size() >= MAX_PENDING_EVENTS)) format_events(out);
+}
+
+
+// format the events recorded in out
+void format_events(FileOutput& out) {
+   tvector<Event> events;
+   events.swap(out.events);
+   tstring name = out.eventname;
+   for(size_t i = 0; i < events.size(); i++) {
+      if(output_format == FORMAT_NDJSON) print_event_json(name.c_str(), events[i]);
+      else                               print_event_text(name.c_str(), events[i]);
+   }
+   // keep the memory of the vector for the next events
+   events.clear();
+   events.swap(out.events);
+}
+
+
+// print the summary record of a file
+void print_summary_json(const char *name, const CheckSummary& sum) {
+   if(quiet) return;
+   char buf[256];
+   tstring r = "{\"file\":" + json_string(name) + ",\"type\":\"summary\"";
+   snprintf(buf, sizeof(buf), ",\"error\":%s,\"anomaly\":%s,\"errors\":%d,\"anomalies\":%d",
+	    sum.error?"true":"false", sum.anomaly?"true":"false", sum.errors, sum.anomalies);
+   r += buf;
+   if(sum.frames >= 0) {
+      snprintf(buf, sizeof(buf), ",\"frames\":%d,\"duration_ms\":%.3f", sum.frames, sum.time);
+      r += buf;
+   }
+   if(sum.header) {
+      snprintf(buf, sizeof(buf), ",\"header\":%u", sum.header);
+      r += buf;
+   }
+   if(sum.avg_bitrate) {
+      snprintf(buf, sizeof(buf), ",\"bitrate\":{\"avg\":%d,\"vbr\":%s", sum.avg_bitrate, sum.vbr?"true":"false");
+      r += buf;
+      if(sum.max_bitrate) {
+	 snprintf(buf, sizeof(buf), ",\"min\":%d,\"max\":%d", sum.min_bitrate, sum.max_bitrate);
+	 r += buf;
+      }
+      r += "}";
+   }
+   r += "}\n";
+   mprintf("%s", r.c_str());
+}
+
+
+// check for TAG trailers, returns the end of the frame data
+// Note that we emit a warning if we found more than one tag, even
+// if ign_tag is set, unless ign_end is also set.
+off_t check_tag_trailers(const char *name, StreamWindow& in, int& errors) {
+   off_t avail;
+   off_t end = in.length();
+   Tagv1 *tag=new Tagv1;
+   int tag_counter=0;
+   while((end>=128) && (end-128>=in.first())) {
+      tag->setTarget(in.data(end-128, 128, avail));
+      if(!tag->isValid()) break;
+      tag_counter++;
+      if((!ign_tag)||((tag_counter>1)&&!ign_end)) {
+	 Event e(Event::TAG_TRAILER);
+	 e.offset = end - 128;
+	 e.count = tag_counter;
+	 e.actual = tag->version();
+	 e.flag = tag->isValidSpecs();
+	 report(name, e);
+	 errors++;
+      }
+      end-=128;
+   } 
+   delete tag;
+   return end;
+}
+
+
+// search the next frame from start to end after an invalid header,
+// head is the header of the previous frame, return the distance of the
+// next frame from start or -1 if there is none (junk at eof)
+off_t find_resync(StreamWindow& in, off_t start, off_t end, Header head) {
+   off_t avail;
+   // first look for any isolated frame with the same header
+   off_t s = find_next_header(in, start, end, 1);
+   if(s<0) return s;
+   
+   // else look for a regular stream (which can not start before any valid frame)
+   Header h = get_header(in.data(start+s, 4, avail));
+   if(!head.sameConstant(h)) {
+      off_t s2 = find_next_header(in, start+s, end, MIN_VALID);
+      s = (s2<0) ? s2 : s+s2;
+   }
+   return s;
+}
+
+
+// calculate the crc16 of the frame at p into crc, rest is the number of
+// bytes from p up to the end of the frame data
+// returns false if the protected bits of the frame are unknown
+inline bool frame_crc(CRC16& crc, const unsigned char *p, Header h, off_t rest) {
+   // reset crc checker
+   crc.reset(0xffff);
+   // get length of side info
+   int s = sideinfo_length(h);
+   int bits = 0;
+   if((s == 0) && (h.layer() == 2) && (rest >= LAYER2_MAX_CRC_LENGTH+7)) {
+      bits = layer2_crc_bits(h, p + 6);
+      s = bits >> 3;
+      bits &= 7;
+   }
+   if(s == 0) return false;
+   // calc crc
+   crc.add(p + 2, 2);
+   crc.add(p + 6, s);
+   if(bits) crc.add_bits(p[6 + s], bits);
+   return true;
+}
+
+
+// state of the frame by frame check of error_check()
+struct ScanState {
+   off_t start;   // position of the next frame
+   off_t rest;    // bytes from start up to the end of the frame data
+   int frame;     // number of the next frame
+   double time;   // start time of the next frame in ms
+   int l;         // length of the previous frame (0 == none)
+   Header head;   // header of the previous frame
+   int errors;
+   unsigned long long bytes; // length of the valid frames, for their bitrates
+   int min_bitrate;          // (0 == no valid frame)
+   int max_bitrate;
+};
+
+
+// start a check at the frame at start with header head, rest bytes of frame data
+void scan_start(ScanState& st, off_t start, off_t rest, Header head, int errors = 0) {
+   st.start = start;
+   st.rest = rest;
+   st.frame = 0;
+   st.time = 0.0;
+   st.l = 0;
+   st.head = head;
+   st.errors = errors;
+   st.bytes = 0;
+   st.min_bitrate = 0;
+   st.max_bitrate = 0;
+}
+
+
+// what scan_frames() does with the errors it finds (its template parameter)
+enum {
+   SCAN_REPORT,  // report them, fix them with fix_headers and fix_crc
+   SCAN_VERDICT  // --verdict-only: stop at the first one, no events, fixes or progress
+};
+
+
+// report event e about file name unless scan_frames<SCAN_VERDICT>
+template<int POLICY>
+inline void scan_report(const char *name, const Event& e) {
+   if(POLICY == SCAN_REPORT) report(name, e);
+}
+
+
+// check frame by frame from st.start until the end of the frame data or
+// until a frame starts at or behind stop (-1 == no limit), update st
+template<int POLICY>
+void scan_frames(const char *name, StreamWindow& in, ScanState& st, off_t stop, bool& tags_checked, 
+		 CRC16& crc, bool fix_headers, bool fix_crc) {
+   const bool verdict = POLICY == SCAN_VERDICT;
+   // the options, read once (the calls in the loop may change any global)
+   const bool ignore_sync  = ign_sync;
+   const bool ignore_const = ign_const;
+   const bool ignore_bit   = ign_bit;
+   const bool ignore_crc   = ign_crc;
+   const bool dots         = !verdict && progress && !segment_events;
+   const int max_err       = verdict ? 1 : max_errors;
+   if(verdict) fix_headers = fix_crc = false;
+   const unsigned char *p;
+   off_t avail;
+   off_t s;
+   off_t start = st.start;
+   off_t rest = st.rest;
+   int frame = st.frame;
+   double time = st.time;
+   int l = st.l;
+   Header head = st.head;
+   int errors = st.errors;
+   unsigned long long bytes = st.bytes;
+   int min_br = st.min_bitrate;
+   int max_br = st.max_bitrate;
+   
+   while((rest>=4) && ((stop<0) || (start<stop))) {
+      // --jobs: leave the rest of a segment with too many messages to the sequential check
+      if(segment_events && (segment_events->size() >= MAX_SEGMENT_MESSAGES)) break;
+      p = in.data(start, FRAME_LOOKAHEAD, avail);
+      if(!tags_checked && in.lengthKnown()) {
+	 tags_checked = true;
+	 rest = check_tag_trailers(name, in, errors) - start;
+	 if(rest < 4) break;
+      }
+      Header h = get_header(p);
+      if(dots) {
+	 if((frame%1000)==0) {
+	    putc('.', stderr);
+	    fflush(stderr);
+	 }
+      }
+      if(!valid_frame(h)) {
+	 // invalid header 
+	 
+	 // search for next valid header
+	 if(!l) {
+	    mprintf("ERROR! Invalid header with no previous frame. Needs debuging.\n");
+	 }
+	 // search within previous frame
+	 start-=(l-4);
+	 rest+=(l-4);
+	 s = find_resync(in, start, start+rest, head);
+	 if(s<0) { // error: junk at eof
+	    start+=(l-4);
+	    rest-=(l-4);
+	    break;
+	 }
+	 
+	 if(!ignore_sync) {
+	    Event e = frame_event((s<l-4) ? Event::SYNC_SHORT : Event::SYNC_LONG, frame - 1, time, start - 4);
+	    e.expected = l;
+	    e.actual = s + 4;
+	    scan_report<POLICY>(name, e);
+	    errors++;
+	 }	    
+
+	 // try to fix header including sync information
+	 if(fix_headers && (s>l-4)) {
+	    unsigned int old_padding_bit = head.padding_bit;
+	    head.padding_bit = 0;
+	    if(s-l+4 == frame_length(head)) {
+	       scan_report<POLICY>(name, frame_event(Event::FIX_SYNC, frame, time, start+l-4));
+	       set_header((unsigned char *)in.data(start+l-4, 4, avail), head);
+	       frame++; // we just created a new frame
+	       time+=frame_duration(head);
+	       l = s-l+4;
+	    } else {
+	       head.padding_bit = 1;
+	       if(s-l+4 == frame_length(head)) {
+		  scan_report<POLICY>(name, frame_event(Event::FIX_SYNC, frame, time, start+l-4));
+		  set_header((unsigned char *)in.data(start+l-4, 4, avail), head);
+		  frame++; // we just created a new frame
+		  time+=frame_duration(head);
+		  l = s-l+4;
+	       } else {
+		  // prevent possible side effect
+		  head.padding_bit = old_padding_bit;
+	       } 		  
+	    }
+	 } 
+
+	 // position on next frame
+	 rest -= s;
+	 start += s;
+      } else {
+	 // valid header
+	 
+	 // check for constant parameters
+	 if(!head.sameConstant(h)) {
+	    if(!ignore_const) {
+	       Event e = frame_event(Event::CONSTANT_SWITCH, frame, time, start);
+	       e.expected = (unsigned int)head.get_int();
+	       e.actual = (unsigned int)h.get_int();
+	       scan_report<POLICY>(name, e);
+	       errors++;
+	    }
+	    if(fix_headers) {
+	       scan_report<POLICY>(name, frame_event(Event::FIX_HEADER, frame, time, start));
+	       // fix only what should be
+	       set_header(h, head);
+	       set_header((unsigned char *)p, h);
+	    } 
+	 }
+	 if(head.bitrate_index != h.bitrate_index) {
+	    if(!ignore_bit) {
+	       Event e = frame_event(Event::BITRATE_SWITCH, frame, time, start);
+	       e.expected = head.bitrate();
+	       e.actual = h.bitrate();
+	       scan_report<POLICY>(name, e);
+	       errors++;
+	       if(fix_headers) {
+		  scan_report<POLICY>(name, frame_event(Event::FIX_HEADER, frame, time, start));
+		  // fix only what should be
+		  h.bitrate_index=head.bitrate_index;
+		  set_header((unsigned char *)p, h);
+	       } 
+	    }
+	 }
+	 head = h;
+		 
+	 // check crc16
+	 if((!ignore_crc)&&(h.protection_bit==0)&&(rest>=32+6)&&frame_crc(crc, p, h, rest)) {
+	    // check crc
+	    unsigned short c = p[5] | ((unsigned short)(p[4])<<8);
+	    int fixed_crc = 0;
+	    if(c != crc.crc()) {
+	       if(fix_crc) {
+		  fixed_crc = set_crc_value((unsigned char *) &(p[4]), crc.crc());
+	       }
+	       Event e = frame_event(Event::CRC_ERROR, frame, time, start);
+	       e.expected = crc.crc();
+	       e.actual = c;
+	       e.flag = fixed_crc;
+	       scan_report<POLICY>(name, e);
+	       errors++;
+	    }
+	 }
+	 
+	 // skip to next frame
+	 l = frame_length(h);
+	 rest -= l;
+	 start += l;
+	 frame++;
+	 time+=frame_duration(h);
+	 
+	 // stream parameters
+	 int br = h.bitrate();
+	 if((br < min_br) || (min_br == 0)) min_br = br;
+	 if(br > max_br) max_br = br;
+	 bytes += l;
+      }
+      
+      // maximum number of error reached?
+      if(max_err && (errors >= max_err))
+      {
+	 scan_report<POLICY>(name, frame_event(Event::MAX_ERRORS, frame, time, -1));
+	 rest = 0;
+	 break;
+      }
+   }
+   
+   
+   st.start = start;
+   st.rest = rest;
+   st.frame = frame;
+   st.time = time;
+   st.l = l;
+   st.head = head;
+   st.errors = errors;
+   st.bytes = bytes;
+   st.min_bitrate = min_br;
+   st.max_bitrate = max_br;
+}
+
+
+// --jobs: one segment of a large file, checked by its own thread
+struct Segment {
+   const char *name;
+   StreamWindow *in;                 // own window onto the file
+   off_t stop;                       // start of the next segment (-1 == none)
+   Header first;                     // header of the first frame
+   ScanState st;                     // frame numbers and times relative to the segment
+   tvector<Event> events;            // events with relative frame numbers and times
+};
+
+
+// --jobs: check one segment of a file
+void *segment_worker(void *arg) {
+   Segment& seg = *(Segment *)arg;
+   CRC16 crc(CRC16::CRC_16);
+   bool tags_checked = true;
+   segment_events = &seg.events;
+   scan_frames<SCAN_REPORT>(seg.name, *seg.in, seg.st, seg.stop, tags_checked, crc, false, false);
+   segment_events = 0;
+   return 0;
+}
+
+
+// return the number of segments to check in parallel for rest bytes of frame
+// data (1 == check sequentially)
+int segments(const StreamWindow& in, bool fix, off_t rest) {
+   // modified data and the position of the last error need the sequential check
+   if((jobs < 2) || fix || max_errors || !in.seekable()) return 1;
+   off_t n = rest / SEGMENT_MIN_SIZE;
+   return (n < jobs) ? (int)n : jobs;
+}
+
+
+// check the frames of a large file in n segments in parallel: every segment
+// starts with the first regular stream behind its share of the file;
+// then the segments are joined in order: as long as a segment starts exactly
+// where the previous one ended (with compatible headers) its messages are
+// printed with absolute frame numbers and times, otherwise (or if it gave
+// up) it is checked again sequentially, starting where the previous ended
+void scan_segmented(const char *name, StreamWindow& in, ScanState& st, int n, CRC16& crc) {
+   off_t avail;
+   off_t end = st.start + st.rest;
+   
+   // find the starts of the segments
+   tvector<off_t> pos;
+   pos += st.start;
+   for(int k = 1; k < n; k++) {
+      off_t b = st.start + (st.rest / n) * k;
+      off_t f = find_next_header(in, b, end, MIN_VALID);
+      if((f >= 0) && (b + f > pos[pos.size() - 1])) pos += b + f;
+   }
+   
+   // check segments
+   tvector<Segment> seg(pos.size());
+   tvector<pthread_t> threads(pos.size());
+   for(size_t k = 0; k < pos.size(); k++) {
+      Segment& sg = seg[k];
+      sg.name = name;
+      sg.in = in.twin();
+      sg.stop = (k + 1 < pos.size()) ? pos[k + 1] : -1;
+      sg.first = get_header(in.data(pos[k], 4, avail));
+      scan_start(sg.st, pos[k], end - pos[k], sg.first);
+      if(pthread_create(&threads[k], 0, segment_worker, &sg))
+	userError("can't create worker thread!\n");
+   }
+   
+   // join segments
+   bool tags_checked = true;
+   for(size_t k = 0; k < pos.size(); k++) {
+      Segment& sg = seg[k];
+      pthread_join(threads[k], 0);
+      // (a bitrate switch at the join is only a message without -B)
+      if((st.start == pos[k]) && st.head.sameConstant(sg.first) && (ign_bit || (st.head.bitrate_index == sg.first.bitrate_index))) {
+	 for(size_t i = 0; i < sg.events.size(); i++) {
+	    Event e = sg.events[i];
+	    e.frame += st.frame;
+	    e.time += st.time;
+	    report(name, e);
+	 }
+	 st.start = sg.st.start;
+	 st.rest = sg.st.rest;
+	 st.frame += sg.st.frame;
+	 st.time += sg.st.time;
+	 st.l = sg.st.l;
+	 st.head = sg.st.head;
+	 st.errors += sg.st.errors;
+	 st.bytes += sg.st.bytes;
+	 if(sg.st.min_bitrate && ((sg.st.min_bitrate < st.min_bitrate) || (st.min_bitrate == 0)))
+	   st.min_bitrate = sg.st.min_bitrate;
+	 if(sg.st.max_bitrate > st.max_bitrate) st.max_bitrate = sg.st.max_bitrate;
+      }
+      // continue sequentially if the segment did not line up or gave up
+      scan_frames<SCAN_REPORT>(name, in, st, sg.stop, tags_checked, crc, false, false);
+      delete sg.in;
+   }
 }
 
 
-// returns true on error
-bool error_check(const char *name, const unsigned char *stream, int len, CRC16& crc, bool fix_headers, bool fix_crc) {
+// returns true on error, number of errors and frames in sum
+// start is the position of the first frame (see find_next_header())
+bool error_check(const char *name, StreamWindow& in, off_t start, CRC16& crc, bool fix_headers, bool fix_crc, CheckSummary& sum) {
    int errors = 0;
-   const unsigned char *p = stream;
-   int start = find_next_header(p, len, MIN_VALID);
-   int rest = len;
+   off_t avail;
+   off_t len = in.length();
+   off_t rest = len;
    int frame=0;
    double time=0.0;
-   int l=0,s;
    Tagv1* tag;
    
    if(start<0) {
       if(!ign_noamp) {
-	 fmes(name, "%s%s%s\n", cerror, (len?"not an audio mpeg stream":"empty file"), cnor);
+	 Event e(len ? Event::NOT_MPEG : Event::EMPTY_FILE);
+	 e.count = len;
+	 report(name, e);
 	 errors++;
       }
    } else {
       
       // check for junk at beginning
       if(start>0) {
-         int pos=0;
+         off_t pos=in.first(); // pipes: only the part still in the window
 	 if(!ign_start) {
-	    fmes(name, "%s%d%s %sbyte%s of junk before first frame header%s\n", 
-		 cval, start, cnor, cerror, (start>1)?"s":"", cnor);
+	    Event e(Event::JUNK_START);
+	    e.count = start;
+	    report(name, e);
 	    errors++;
 	    // check for possible id3 tags within the junk
 	    while(start-pos >= 128)
 	    {
-	    	int offset=Tagv1::find_next_tag(p+pos, start-pos);
+	    	off_t offset=find_next_tag(in, pos, start);
 		if(offset!=-1) {
 		   pos+=offset;
-		   tag=new Tagv1(p+pos);
-	           fmes(name, "in leading junk: %spossible %s id3 tag v%u.%u%s at %s0x%08x%s\n",
-		        cerror, (tag->isValidSpecs()?"valid":"invalid"),
-			(tag->version())>>8, (tag->version())&0xff, cnor,
-			cval, pos, cnor);
+		   tag=new Tagv1(in.data(pos, 128, avail));
+		   Event e(Event::TAG_IN_JUNK_START);
+		   e.offset = pos;
+		   e.actual = tag->version();
+		   e.flag = tag->isValidSpecs();
+		   report(name, e);
 		   delete tag;
 		   pos+=3;
 		} else {
@@ -590,334 +1680,73 @@ bool error_check(const char *name, const unsigned char *stream, int len, CRC16&
 	 }
       }
       
-      // check for TAG trailers
-      // Note that we emit a warning if we found more than one tag, even
-      // if ign_tag is set, unless ign_end is also set.
-      tag=new Tagv1(p+rest-128);
-      int tag_counter=0;
-      while((rest>=128)&&tag->isValid()) {
-	 tag_counter++;
-	 if((!ign_tag)||((tag_counter>1)&&!ign_end)) {
-	    fmes(name, "%s%s%s id3 tag trailer v%u.%u found%s\n", 
-	         cerror, (tag_counter>1?"another ":""), (tag->isValidSpecs()?"valid":"invalid"),
-		 (tag->version())>>8, (tag->version())&0xff, cnor);
-	    errors++;
-	 }
-	 rest-=128;
-	 tag->setTarget(p+rest-128);
-      } 
-      delete tag;
+      // check for TAG trailers (pipes: as soon as the end is known)
+      bool tags_checked = in.lengthKnown();
+      if(tags_checked) rest = check_tag_trailers(name, in, errors);
       
       // check whole file
       rest -= start;
-      p += start;
-      Header head = get_header(p);
-      while(rest>=4) {
-	 Header h = get_header(p);
-	 if(progress) {
-	    if((frame%1000)==0) {
-	       putc('.', stderr);
-	       fflush(stderr);
-	    }
+      ScanState st;
+      scan_start(st, start, rest, get_header(in.data(start, 4, avail)), errors);
+      int n = segments(in, fix_headers || fix_crc, rest);
+      if(n > 1) scan_segmented(name, in, st, n, crc);
+      else      scan_frames<SCAN_REPORT>(name, in, st, -1, tags_checked, crc, fix_headers, fix_crc);
+      start = st.start;
+      rest = st.rest;
+      frame = st.frame;
+      time = st.time;
+      errors = st.errors;
+      if(binary_log && st.bytes && (time > 0.0)) {
+	 // kbit/s == bit/ms
+	 sum.avg_bitrate = (int)(st.bytes * 8 / time);
+	 sum.min_bitrate = st.min_bitrate;
+	 sum.max_bitrate = st.max_bitrate;
+	 sum.vbr = st.min_bitrate != st.max_bitrate;
+      }
+      
+      // pipes: the end is known now (unless stopped by max_errors)
+      if(!tags_checked && rest) {
+	 rest = check_tag_trailers(name, in, errors) - start;
+      }
+      
+      // check for truncated file
+      if(rest < 0) {
+	 if(!ign_trunc) {
+	    Event e = frame_event(Event::TRUNCATED, frame, time, -1);
+	    e.count = -rest;
+	    report(name, e);
+	    errors++;
 	 }
-	 if(!(h.isValid()&&(frame_length(h)>=21))) {
-	    // invalid header 
-	    
-	    // search for next valid header
-	    if(!l) {
-	       printf("ERROR! Invalid header with no previous frame. Needs debuging.\n");
-	    }
-	    // search within previous frame
-	    p-=(l-4);
-	    start-=(l-4);
-	    rest+=(l-4);
-	    
-	    // first look for any isolated frame with the same header
-	    s = find_next_header(p, rest, 1);
-	    if(s<0) { // error: junk at eof
-	       p+=(l-4);
-	       start+=(l-4);
-	       rest-=(l-4);
-	       break;
+      }
+      
+      // check for trailing junk
+      if(rest > 0) {
+	 if(!ign_end) {
+	    Event e = frame_event(Event::JUNK_END, frame, time, start);
+	    e.count = rest;
+	    report(name, e);
+	    errors++;
+	    // check for possible id3 tags within the junk (pipes: only in the window)
+	    if(start < in.first()) {
+	       rest -= in.first() - start;
+	       start = in.first();
 	    }
-	    
-	    // else look for a regular stream
-      	    h = get_header(p+s);
-      	    if(!head.sameConstant(h))
-	       s = find_next_header(p, rest, MIN_VALID);
-	    if(s<0) { // error: junk at eof
-	       p+=(l-4);
-	       start+=(l-4);
-	       rest-=(l-4);
-	       break;
-	    }
-      	    
-	    if(!ign_sync) {
-	       if(s<l-4) {
-		  fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %ssync error (frame too short)%s at %s0x%08x%s, %s%d%s byte%s mising\n", 
-		       cval, frame - 1, cnor,
-		       cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		       cerror, cnor, cval, start - 4, cnor,
-		       cval, l-4-s, cnor, (l-4-s>1)?"s":"");
-		  errors++;
-	       } else {
-		  fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %ssync error (frame too long)%s at %s0x%08x%s, skipping %s%d%s byte%s at %s0x%08x%s\n",
-		       cval, frame - 1, cnor,
-		       cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		       cerror, cnor, cval, start - 4, cnor,
-		       cval, s-l+4, cnor, (s-l+4>1)?"s":"",
-		       cval, start - 4 + l, cnor);
-		  errors++;
-	       }
-	    }	    
-
-	    // try to fix header including sync information
-	    if(fix_headers && (s>l-4)) {
-	       unsigned int old_padding_bit = head.padding_bit;
-	       head.padding_bit = 0;
-	       if(s-l+4 == frame_length(head)) {
-		  fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %sfixing header (including sync)%s\n",
-		       cval, frame, cnor,
-		       cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		       cerror, cnor);
-		  set_header((unsigned char *)(p+l-4), head);
-		  frame++; // we just created a new frame
-		  time+=frame_duration(head);
-		  l = s-l+4;
-	       } else {
-		  head.padding_bit = 1;
-		  if(s-l+4 == frame_length(head)) {
-		     fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %sfixing header (including sync)%s\n",
-			  cval, frame, cnor,
-			  cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-			  cerror, cnor);
-		     set_header((unsigned char *)(p+l-4), head);
-		     frame++; // we just created a new frame
-		     time+=frame_duration(head);
-		     l = s-l+4;
-		  } else {
-		     // prevent possible side effect
-		     head.padding_bit = old_padding_bit;
-		  } 		  
-	       }
-	    } 
-
-	    // position on next frame
-	    p += s;
-	    rest -= s;
-	    start += s;
-	 } else {
-	    // valid header
-	    
-	    // check for constant parameters
-	    if(!head.sameConstant(h)) {
-	       if(!ign_const) {
-		  fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %sconstant parameter switching%s at %s0x%08x%s (%s0x%08x%s -> %s0x%08x%s)\n",
-		       cval, frame, cnor,
-		       cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		       cerror, cnor,
-		       cval, start, cnor,
-		       cval, head.get_int()&CONST_MASK, cnor,
-		       cval, h.get_int()&CONST_MASK, cnor);
-		  if(h.ID!=head.ID)
-		     printf("frame %s%5d%s/%s%2u:%02u%s:   %sMPEG version switching%s (MPEG %s%1.1f%s -> MPEG %s%1.1f%s)\n",
-		            cval, frame, cnor,
-		            cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		            cerror, cnor,
-			    cval, head.version(), cnor,
-			    cval, h.version(), cnor);
-		  if(h.layer_index!=head.layer_index)
-		     printf("frame %s%5d%s/%s%2u:%02u%s:   %sMPEG layer switching%s (layer %s%1d%s -> layer %s%1d%s)\n",
-		            cval, frame, cnor,
-		            cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		            cerror, cnor,
-			    cval, head.layer(), cnor,
-			    cval, h.layer(), cnor);
-		  if(h.samp_rate()!=head.samp_rate())
-		     printf("frame %s%5d%s/%s%2u:%02u%s:   %ssampling frequency switching%s (%s%f%skHz -> %s%f%skHz)\n",
-		            cval, frame, cnor,
-		            cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		            cerror, cnor,
-			    cval, head.samp_rate(), cnor,
-			    cval, h.samp_rate(), cnor);
-		  if(h.mode!=head.mode)
-		     printf("frame %s%5d%s/%s%2u:%02u%s:   %smode switching%s (%s%s%s -> %s%s%s)\n",
-		            cval, frame, cnor,
-		            cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		            cerror, cnor,
-			    cval, head.mode_str(), cnor,
-			    cval, h.mode_str(), cnor);
-		  if(h.protection_bit!=head.protection_bit)
-		     printf("frame %s%5d%s/%s%2u:%02u%s:   %sprotection bit switching%s (%s%s%s -> %s%s%s)\n",
-		            cval, frame, cnor,
-		            cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		            cerror, cnor,
-			    cval, head.protection_bit?"no crc":"crc", cnor,
-			    cval, h.protection_bit?"no crc":"crc", cnor);
-		  if(h.copyright!=head.copyright)
-		     printf("frame %s%5d%s/%s%2u:%02u%s:   %scopyright bit switching%s (%s%s%s -> %s%s%s)\n",
-		            cval, frame, cnor,
-		            cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		            cerror, cnor,
-			    cval, head.copyright?"copyright":"no copyright", cnor,
-			    cval, h.copyright?"copyright":"no copyright", cnor);
-		  if(h.original!=head.original)
-		     printf("frame %s%5d%s/%s%2u:%02u%s:   %soriginal bit switching%s (%s%s%s -> %s%s%s)\n",
-		            cval, frame, cnor,
-		            cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		            cerror, cnor,
-			    cval, head.original?"original":"not original", cnor,
-			    cval, h.original?"original":"not original", cnor);
-		  errors++;
-	       }
-	       if(fix_headers) {
-		  fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %sfixing header%s\n", 
-		       cval, frame, cnor,
-		       cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		       cerror, cnor);
-		  // fix only what should be
-		  set_header(h, head);
-		  set_header((unsigned char *)p, h);
-	       } 
-	    }
-	    if(head.bitrate_index != h.bitrate_index) {
-	       if(!ign_bit) {
-		  fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %sbitrate switching%s (%s%d%s -> %s%d%s)\n", 
-		       cval, frame, cnor,
-		       cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		       cerror, cnor, 
-		       cval, head.bitrate(), cnor,
-		       cval, h.bitrate(), cnor);
-		  errors++;
-		  if(fix_headers) {
-		     fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %sfixing header%s\n", 
-			  cval, frame, cnor,
-			  cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-			  cerror, cnor);
-		     // fix only what should be
-		     h.bitrate_index=head.bitrate_index;
-		     set_header((unsigned char *)p, h);
-		  } 
-	       }
-	    }
-	    head = h;
-	    	    
-	    // check crc16
-	    if((!ign_crc)&&(h.protection_bit==0)&&(rest>=32+6)) {
-	       // reset crc checker
-	       crc.reset(0xffff);
-	       // get length of side info
-	       s = 0;
-	       if(h.version()==1.0) { // mpeg 1.0
-		  switch(h.layer()) { 
-		   case 3:            // layer 3
-		     if(h.mode==Header::SINGLE_CHANNEL) s = 17;
-		     else s = 32;
-		     break;
-		     
-		   case 1:            // layer 1
-		     switch(h.mode) {
-		      case Header::SINGLE_CHANNEL: s = 16; break;
-		      case Header::DUAL_CHANNEL:   s = 32; break;
-		      case Header::STEREO:         s = 32; break;
-		      case Header::JOINT_STEREO:   s = 18+h.mode_extension*2; break;
-		     }
-		     break;
-		     
-		   default:
-		     s = 0; // mpeg 1.0 layer 2 not yet supported
-		     break;		     
-		  } 
-	       } else {               // mpeg 2.0 or 2.5
-		  if(h.layer()==3) {  // layer 3
-		     if(h.mode==Header::SINGLE_CHANNEL) s = 9; 
-		     else s = 17;
-		  } else {
-		     s = 0; // mpeg 2.0 or 2.5 layer 1 and 2 not yet supported
-		  }
-	       }
-	       if(s) {
-		  // calc crc
-		  crc.add(p[2]);
-		  crc.add(p[3]);
-		  for(int i=0; i < s; i++) crc.add(p[i+6]);
-		  // check crc
-		  unsigned short c = p[5] | ((unsigned short)(p[4])<<8);
-		  int fixed_crc = 0;
-		  if(c != crc.crc()) {
-		     if(fix_crc) {
-			fixed_crc = set_crc_value((unsigned char *) &(p[4]), crc.crc());
-		     }
-		     fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %scrc error%s (%s0x%04x%s!=%s0x%04x%s)%s\n",
-			  cval, frame, cnor,
-			  cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		          cerror, cnor, 
-			  cval, c, cnor, cval, crc.crc(), cnor, fixed_crc ? " fixed" : "");
-		     errors++;
-		  }
-//		  printf("frame=%d, pos=%d, s=%d, c=%04x crc.crc()=%04x\n", frame, start, s, c, crc.crc());
-	       }
-	    }
-	    
-	    // skip to next frame
-	    l = frame_length(h);
-	    p += l;
-	    rest -= l;
-	    start += l;
-	    frame++;
-	    time+=frame_duration(h);
-	 }
-	 
-	 // maximum number of error reached?
-	 if(max_errors && (errors >= max_errors))
-	 {
-	    fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %smaximum number of errors exceeded%s\n", 
-		 cval, frame, cnor,
-		 cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		 cerror, cnor);
-	    rest = 0;
-	    break;
-	 }
-      }
-      
-      // check for truncated file
-      if(rest < 0) {
-	 if(!ign_trunc) {
-	    fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %sfile truncated%s, %s%d%s byte%s missing for last frame\n", 
-		 cval, frame, cnor,
-		 cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		 cerror, cnor, cval, -rest, cnor, (-rest)>1?"s":"");	    
-	    errors++;
-	 }
-      }
-      
-      // check for trailing junk
-      if(rest > 0) {
-	 if(!ign_end) {
-	    fmes(name, "frame %s%5d%s/%s%2u:%02u%s: %s%d%s %sbyte%s of junk after last frame%s at %s0x%08x%s\n", 
-		 cval, frame, cnor,
-		 cval, (unsigned int)(time/1000)/60, (unsigned int)(time/1000)%60, cnor,
-		 cval, rest, cnor, cerror, (rest>1)?"s":"", cnor, cval, start, cnor);
-	    errors++;
-	    // check for possible id3 tags within the junk
 	    while(rest >= 128)
 	    {
-	    	int offset=Tagv1::find_next_tag(p, rest);
+	    	off_t offset=find_next_tag(in, start, start+rest);
 		if(offset!=-1) {
 		   start+=offset;
-		   p+=offset;
-		   tag=new Tagv1(p);
-	           fmes(name, "in trailing junk: %spossible %s id3 tag v%u.%u%s at %s0x%08x%s\n",
-		        cerror, (tag->isValidSpecs()?"valid":"invalid"),
-				(tag->version())>>8, (tag->version())&0xff, cnor,
-			cval, start, cnor);
+		   tag=new Tagv1(in.data(start, 128, avail));
+		   Event e(Event::TAG_IN_JUNK_END);
+		   e.offset = start;
+		   e.actual = tag->version();
+		   e.flag = tag->isValidSpecs();
+		   report(name, e);
 		   delete tag;
-		   p+=3;
 		   start+=3;
 		   rest-=(offset+3);
 		} else {
 		   start+=rest;
-		   p+=rest;
 		   rest=0;
 		}
 	    }
@@ -929,92 +1758,207 @@ bool error_check(const char *name, const unsigned char *stream, int len, CRC16&
       fflush(stderr);
    }
    if((errors == 0) && show_valid_files)
-      fmes(name, "%svalid audio mpeg stream%s\n", cok, cnor);
+      report(name, Event(Event::VALID));
+   sum.frames = frame;
+   sum.time = time;
+   sum.errors += errors;
    return errors > 0;
 }
 
 
-// returns true on anomaly
-bool anomaly_check(const char *name, const unsigned char *p, int len, bool err_check, int& err) {
-   bool had_ano = false;
-   int start = find_next_header(p, len, MIN_VALID);
-   if(start>=0) {
-      Header h = get_header(p+start);
-      if(!ano_any_ver) {
-	 if(h.version()!=1.0) {
-	    fmes(name, "%sanomaly%s: audio mpeg version %s%3.1f%s stream\n", 
-		 cano, cnor, cval, h.version(), cnor);	 
-	    had_ano = true;
-	 } 
+// --verdict-only: error_check() reduced to its result: no messages, no
+// counts and no fixes, returns true at the first error which is not ignored
+bool verdict_check(const char *name, StreamWindow& in, off_t start, CRC16& crc) {
+   off_t avail;
+   if(start<0) return !ign_noamp;
+   if((start>0) && !ign_start) return true;
+   
+   // tag trailers (pipes: as soon as the end is known)
+   int errors = 0;
+   off_t rest = in.length();
+   bool tags_checked = in.lengthKnown();
+   if(tags_checked) rest = check_tag_trailers(name, in, errors);
+   if(errors) return true;
+   
+   // frames
+   ScanState st;
+   scan_start(st, start, rest - start, get_header(in.data(start, 4, avail)));
+   scan_frames<SCAN_VERDICT>(name, in, st, -1, tags_checked, crc, false, false);
+   if(st.errors) return true;
+   start = st.start;
+   rest = st.rest;
+   
+   // pipes: the end is known now
+   if(!tags_checked && rest) {
+      rest = check_tag_trailers(name, in, errors) - start;
+      if(errors) return true;
+   }
+   if(rest<0) return !ign_trunc;
+   if(rest>0) return !ign_end;
+   return false;
+}
+
+
+// returns true on anomaly, number of anomalies in sum
+// first is the header of the first frame or 0 if there is none
+bool anomaly_check(const char *name, const Header *first, off_t len, bool err_check, int& err, CheckSummary& sum) {
+   if(first) {
+      Header h = *first;
+      Event e;
+      e.actual = (unsigned int)h.get_int();
+      int n = sum.anomalies;
+      if(!ano_any_ver && (h.version()!=1.0)) {
+	 e.type = Event::ANOMALY_VERSION;
+	 report(name, e);
+	 sum.anomalies++;
       }
-      if(!ano_any_layer) {
-	 if(h.layer()!=3) {
-	    fmes(name, "%sanomaly%s: audio mpeg %slayer %d%s stream\n", 
-		 cano, cnor, cval, h.layer(), cnor);	 
-	    had_ano = true;
-	 } 
+      if(!ano_any_layer && (h.layer()!=3)) {
+	 e.type = Event::ANOMALY_LAYER;
+	 report(name, e);
+	 sum.anomalies++;
       }
-      if(!ano_any_rate) {
-	 if(h.samp_rate()!=44.1) {
-	    fmes(name, "%sanomaly%s: sampling rate %s%4.1fkHz%s\n", 
-		 cano, cnor, cval, h.samp_rate(), cnor); 
-	    had_ano = true;
-	 }
+      if(!ano_any_rate && (h.samp_rate()!=44.1)) {
+	 e.type = Event::ANOMALY_SAMPLING;
+	 report(name, e);
+	 sum.anomalies++;
       }
-      if(!ano_any_bit) {
-	 if(h.bitrate()!=128) {
-	    fmes(name, "%sanomaly%s: bitrate %s%3dkbit/s%s\n", 
-		 cano, cnor, cval, h.bitrate(), cnor); 
-	    had_ano = true;
-	 }
+      if(!ano_any_bit && (h.bitrate()!=128)) {
+	 e.type = Event::ANOMALY_BITRATE;
+	 report(name, e);
+	 sum.anomalies++;
       }
-      if(!ano_any_mode) {
-	 if(h.mode!=Header::JOINT_STEREO) {
-	    fmes(name, "%sanomaly%s: mode %s%s%s\n", 
-		 cano, cnor, cval, h.mode_str(), cnor);  
-	    had_ano = true;
-	 }
+      if(!ano_any_mode && (h.mode!=Header::JOINT_STEREO)) {
+	 e.type = Event::ANOMALY_MODE;
+	 report(name, e);
+	 sum.anomalies++;
       }
-      if(!ano_any_crc) {
-	 if(h.protection_bit==1) {
-	    fmes(name, "%sanomaly%s: %sno crc%s\n", 
-		 cano, cnor, cval, cnor);	    
-	    had_ano = true;
-	 }
+      if(!ano_any_crc && (h.protection_bit==1)) {
+	 e.type = Event::ANOMALY_CRC;
+	 report(name, e);
+	 sum.anomalies++;
       }
-      if(!ano_any_emp) {
-	 if(h.emphasis!=Header::emp_NONE) {
-	    fmes(name, "%sanomaly%s: emphasis %s%s%s\n", 
-		 cano, cnor, cval, h.emphasis_str(), cnor); 
-	    had_ano = true;
-	 }
+      if(!ano_any_emp && (h.emphasis!=Header::emp_NONE)) {
+	 e.type = Event::ANOMALY_EMPHASIS;
+	 report(name, e);
+	 sum.anomalies++;
       }
+      return sum.anomalies > n;
    } else {
       if((!err_check)&&(!ign_noamp)) {
-	 fmes(name, "%s%s%s\n", cerror, (len?"not an audio mpeg stream":"empty file"), cnor);
+	 Event e(len ? Event::NOT_MPEG : Event::EMPTY_FILE);
+	 e.count = len;
+	 report(name, e);
+	 sum.errors++;
 	 ++err;
       }
    }
-   return had_ano;
+   return false;
 }
 					
 
+// contents of a Xing/Info or VBRI header in the first frame
+struct VbrHeader {
+   unsigned int frames;  // number of frames (without the header frame)
+   unsigned int bytes;   // number of bytes (including the header frame)
+   bool vbr;             // false for Info headers and LAME cbr
+};
+
+inline unsigned int get_be32(const unsigned char *p) {
+   return (p[0]<<24) | (p[1]<<16) | (p[2]<<8) | p[3];
+}
+
+// crc of the LAME tag (crc16 with reversed polynom 0xa001)
+unsigned short lame_crc(const unsigned char *p, int n) {
+   unsigned short crc = 0;
+   for(int i = 0; i < n; i++) {
+      crc ^= p[i];
+      for(int k = 0; k < 8; k++)
+	crc = (crc & 1) ? ((crc >> 1) ^ 0xa001) : (crc >> 1);
+   }
+   return crc;
+}
+
+// read the Xing/Info or VBRI header (and the LAME extension) of the frame at start
+// returns false if there is none or if it is not consistent with the file size
+bool read_vbr_header(StreamWindow& in, off_t start, VbrHeader& vbr) {
+   off_t avail;
+   const unsigned char *p = in.data(start, MAX_FRAME_LENGTH, avail);
+   if(avail < 4) return false;
+   Header h = get_header(p);
+   if(!valid_frame(h) || (h.layer() != 3)) return false;
+   int l = frame_length(h);
+   if(avail < l) return false;
+   
+   // Xing/Info after the side info, VBRI always at 36
+   int x = 4 + ((h.protection_bit==0) ? 2 : 0);
+   if(h.version()==1.0) x += (h.mode==Header::SINGLE_CHANNEL) ? 17 : 32;
+   else                 x += (h.mode==Header::SINGLE_CHANNEL) ? 9 : 17;
+   if((x + 16 <= l) && ((memcmp(p + x, "Xing", 4) == 0) || (memcmp(p + x, "Info", 4) == 0))) {
+      unsigned int flags = get_be32(p + x + 4);
+      if((flags & 3) != 3) return false; // need frames and bytes
+      vbr.frames = get_be32(p + x + 8);
+      vbr.bytes = get_be32(p + x + 12);
+      vbr.vbr = (p[x] == 'X');
+      
+      // LAME extension: check crc and vbr method
+      int t = x + 120;
+      if((t + 36 <= l) && ((memcmp(p + t, "LAME", 4) == 0) || (memcmp(p + t, "Lav", 3) == 0))) {
+	 if(lame_crc(p, t + 34) != ((p[t+34] << 8) | p[t+35])) return false;
+	 int method = p[t+9] & 15;
+	 if((method == 1) || (method == 8)) vbr.vbr = false;
+      }
+   } else if((36 + 18 <= l) && (memcmp(p + 36, "VBRI", 4) == 0)) {
+      vbr.bytes = get_be32(p + 36 + 10);
+      vbr.frames = get_be32(p + 36 + 14);
+      vbr.vbr = true;
+   } else {
+      return false;
+   }
+   
+   // the header must describe (most of) the rest of the file
+   off_t rest = in.length() - start;
+   if((vbr.frames == 0) || (vbr.bytes < (unsigned int)l) || (vbr.bytes > rest) || (vbr.bytes < rest - rest/10))
+     return false;
+   // and the average bitrate must be possible
+   double samples = (h.layer()==1) ? 384 : (((h.layer()==3) && (h.version()!=1.0)) ? 576 : 1152);
+   double duration = (vbr.frames + 1) * samples / h.samp_rate();
+   double avgbr = vbr.bytes * 8 / duration;
+   if((avgbr < 8) || (avgbr > 448)) return false;
+   return true;
+}
+
 // returns the stream duration in ms
-// also returns minimum, maximum and average bitrates if told to
-unsigned int stream_duration(const unsigned char *p, int len, unsigned short int *minbr, unsigned short int *maxbr, unsigned short int *avgbr) {
-   int next = find_next_header(p, len, MIN_VALID);
-   int rest = len - next;
+// also returns if the bitrate is variable, the average bitrate and the
+// minimum and maximum bitrate if told to (from the Xing/Info or VBRI header
+// if there is one, then minimum and maximum are not set, else by reading all frames)
+unsigned int stream_duration(StreamWindow& in, bool *vbr, unsigned short int *avgbr,
+			     unsigned short int *minbr = 0, unsigned short int *maxbr = 0) {
+   off_t avail;
+   off_t len = in.length();
+   off_t next = find_next_header(in, 0, len, MIN_VALID);
+   off_t rest = len - next;
    double duration = 0.0;
    unsigned short int min = 2048, max = 0;
-   unsigned long int bytes = 0;
+   unsigned long long bytes = 0;
 
    if(next<0) return 0;
 
+   // vbr header
+   VbrHeader v;
+   if(read_vbr_header(in, next, v)) {
+      Header h = get_header(in.data(next, 4, avail));
+      double samples = (h.layer()==1) ? 384 : (((h.layer()==3) && (h.version()!=1.0)) ? 576 : 1152);
+      duration = (v.frames + 1) * samples / h.samp_rate();
+      if(vbr!=NULL) { *vbr = v.vbr; }
+      if(avgbr!=NULL) { *avgbr = ((unsigned long long)v.bytes * 8) / (unsigned int)duration; }
+      return (unsigned int)duration;
+   }
+
    while(rest>=4) {
-      Header h=get_header(p+next);
-      if(!h.isValid()) {
-      	 int old = next;
-	 next = find_next_header(p+old, rest, MIN_VALID);
+      Header h=get_header(in.data(next, 4, avail));
+      if(!valid_frame(h)) {
+      	 off_t old = next;
+	 next = find_next_header(in, old, old+rest, MIN_VALID);
 	 if(next<0) break;
 	 rest -= next;
 	 next += old;
@@ -1032,21 +1976,23 @@ unsigned int stream_duration(const unsigned char *p, int len, unsigned short int
       }
    }
 
+   if(vbr!=NULL) { *vbr = (min != max); }
+   if(avgbr!=NULL) { *avgbr = (bytes * 8) / (unsigned int)duration; }
    if(minbr!=NULL) { *minbr = min; }
    if(maxbr!=NULL) { *maxbr = max; }
-   if(avgbr!=NULL) { *avgbr = (bytes * 8) / (unsigned int)duration; }
    return (unsigned int)duration;
 }
 
 
 // return true if junk was found and cut
-bool cut_junk_end(const char *name, const unsigned char *p, int len, const unsigned char *free_p, int fd, int& err) {
+bool cut_junk_end(const char *name, const unsigned char *p, off_t len, const unsigned char *free_p, int fd, int& err) {
 // this is basically the error_check routine which treats only the trainling junk case
 // (implemented by Pollyanna Lindgren <jtlindgr@cs.helsinki.fi>)
-   int start = find_next_header(p, len, MIN_VALID);
-   int rest = len;
+   off_t start = find_next_header(p, len, MIN_VALID);
+   off_t rest = len;
    int frame=0;
-   int l,s;
+   int l;
+   off_t s;
    Tagv1 *tag = 0;
    bool have_a_tag = false;
 
@@ -1096,7 +2042,7 @@ bool cut_junk_end(const char *name, const unsigned char *p, int len, const unsig
 	       fflush(stderr);
 	    }
 	 }
-	 if(!(h.isValid()&&(frame_length(h)>=21))) {
+	 if(!valid_frame(h)) {
 	    // invalid header
 	    
 	    // search for next valid header
@@ -1135,8 +2081,8 @@ bool cut_junk_end(const char *name, const unsigned char *p, int len, const unsig
       
       // remove trailing junk
       if(rest > 0) {
-	 fmes(name, "%scut-junk-end: removing last %s%d%s byte%s, %sretrying%s\n",
-	      cok, cval, rest, cok, (rest>1)?"s":"", dummy?"not (due to dummy) ":"", cnor);
+	 fmes(name, "%scut-junk-end: removing last %s%lld%s byte%s, %sretrying%s\n",
+	      cok, cval, (long long)rest, cok, (rest>1)?"s":"", dummy?"not (due to dummy) ":"", cnor);
 	 if(!dummy) {
 	    // rewrite tag
 	    if(have_a_tag)
@@ -1175,10 +2121,10 @@ bool cut_junk_end(const char *name, const unsigned char *p, int len, const unsig
 					 
    
 // return true if trailing tag was found and cut
-bool cut_tag_end(const char *name, const unsigned char *p, int len, int fd, int& err) {
+bool cut_tag_end(const char *name, const unsigned char *p, off_t len, int fd, int& err) {
 // this is basically the cut_junk_end routine that only looks for a 128 bytes trailing tag
 // (implemented by Jean Delvare <delvare@ensicaen.ismra.fr>)
-   int start = find_next_header(p, len, MIN_VALID);
+   off_t start = find_next_header(p, len, MIN_VALID);
    Tagv1* tag;
 
    if(start<0) {
@@ -1314,7 +2260,7 @@ bool checkForTagsSloppy(const unsigned char *p, size_t len)
 	    (p[i + 3] < 10) && (p[i + 4] < 10) && ((p[i + 5] & 0xf) == 0) && 
 	    (p[i + 6] < 128) && (p[i + 7] < 128) && (p[i + 8] < 128) && (p[i + 9] < 128)))
 	{
-	    printf("%swarning: possible %c%c%c tag found at offset %d (%d from end) (%02x %02x %02x %02x %02x %02x %02x)%s\n", 
+	    mprintf("%swarning: possible %c%c%c tag found at offset %d (%d from end) (%02x %02x %02x %02x %02x %02x %02x)%s\n", 
 		   cano, p[i+0], p[i+1], p[i+2], int(i), int(len - 3 - i), p[i+3]&255, p[i+4]&255, p[i+5]&255, 
 		   p[i+6]&255, p[i+7]&255, p[i+8]&255, p[i+9]&255, cnor);
 	    return true;
@@ -1335,11 +2281,1167 @@ void capitalize(tstring &str)
     }
 }
 
+// result of processing one file
+struct FileResult {
+   FileResult(): err(0), ano(false), tagadded(false), log(false) {}
+   int err;        // number of errors (added to the number of erroneous files)
+   bool ano;       // anomaly found
+   bool tagadded;  // id3 tag added
+   bool log;       // print name to log file
+};
+
+// return values of process_file()
+enum {FILE_SKIPPED, FILE_CHECKED, FILE_RETRY};
+
+// return true if only modes are selected which read a file once from
+// start to end (error and anomaly check), as needed for --stream and pipes
+bool streaming_modes_only(const TAppConfig& ac) {
+   return !(ac("fix-headers")||ac("cut-junk-start")||ac("fix-crc")||ac("cut-junk-end")||ac("cut-tag-end")||edit_frame_byte||
+	    ac("add-tag")||ac("dump-header")||ac("dump-tag")||ac("list")||ac("compact-list")||ac("raw-list"));
+}
+
+// error and anomaly check of the data of one file
+void check_stream(const TAppConfig& ac, const char *name, StreamWindow& in, CRC16& crc, FileResult& res) {
+   bool err_check = ac("error-check") || ac("fix-headers") || ac("fix-crc") || verdict_only;
+   if(!(err_check || ac("anomaly-check"))) return;
+   
+   // first frame, for both checks
+   off_t avail;
+   off_t start = find_next_header(in, 0, in.length(), MIN_VALID);
+   Header first;
+   if(start >= 0) first = get_header(in.data(start, 4, avail));
+   CheckSummary sum;
+   if(start >= 0) sum.header = first.get_int();
+   tstring events;
+   if(binary_log) file_events = &events;
+   
+   // check for errors
+   if(err_check) {
+      if(progress) {
+	 tstring s = tstring(name).shortFilename(79);
+	 fprintf(stderr, "%-79.79s\r", s.c_str());
+	 fflush(stderr);
+      }
+      if(verdict_only ? verdict_check(name, in, start, crc) : error_check(name, in, start, crc, ac("fix-headers"), ac("fix-crc"), sum)) {
+	 res.log = true;
+	 ++res.err;
+      }
+   }
+
+   // check for anomalies
+   if(ac("anomaly-check")) {
+      if(progress) {
+	 tstring s = tstring(name).shortFilename(79);
+	 fprintf(stderr, "%-79.79s\r", s.c_str());
+	 fflush(stderr);
+      }
+      if(anomaly_check(name, (start >= 0) ? &first : 0, in.length(), ac("error-check") || verdict_only, res.err, sum)) res.ano = true;
+   }      
+   sum.error = res.log || (res.err > 0);
+   sum.anomaly = res.ano;
+   
+   // the bitrates in sum are those of the frames seen by error_check()
+   if(binary_log) {
+      file_events = 0;
+      BinaryLog::File file;
+      file.name = name;
+      file.size = in.lengthKnown() ? in.length() : 0;
+      file.sum = sum;
+      tstring buf;
+      BinaryLog::encodeFile(buf, file);
+      buf += events;
+      binary_log->write(buf);
+   }
+   if(output_format == FORMAT_NDJSON) print_summary_json(name, sum);
+}
+
+// --cache-policy: hints for reading file fd of length len
+void advise_file(int fd, off_t len) {
+#ifdef __linux__
+   if(cache_policy & PAGES_SEQUENTIAL) posix_fadvise(fd, 0, len, POSIX_FADV_SEQUENTIAL);
+   if(cache_policy & PAGES_WILLNEED)   posix_fadvise(fd, 0, len, POSIX_FADV_WILLNEED);
+#else
+   (void)fd;
+   (void)len;
+#endif
+}
+
+
+// --cache-policy: hints for the mapping of a file
+void advise_map(const unsigned char *p, off_t len) {
+   if(cache_policy & PAGES_SEQUENTIAL) madvise((void *)p, len, MADV_SEQUENTIAL);
+   if(cache_policy & PAGES_WILLNEED)   madvise((void *)p, len, MADV_WILLNEED);
+}
+
+
+// check stdin (name "-") or a named pipe: these can only be read once
+int process_pipe(const TAppConfig& ac, const char *name, CRC16& crc, FileResult& res) {
+   if(!streaming_modes_only(ac)) {
+      fmes(name, "%signoring pipe (only --error-check and --anomaly-check can read pipes)%s\n", cerror, cnor);
+      return FILE_SKIPPED;
+   }
+   int fd = 0;
+   if(strcmp(name, "-") != 0) {
+      fd = open(name, O_RDONLY | O_BINARY);
+      if(fd==-1) {
+	 perror("open");
+	 userError("can't open file '%s' for reading!\n", name);      
+      }
+   }
+   StreamWindow in(fd, StreamWindow::UNKNOWN_LENGTH, STREAM_WINDOW_SIZE, name);
+   check_stream(ac, name, in, crc, res);
+   // read the rest, so the writer does not get SIGPIPE
+   in.finish();
+   if(fd) close(fd);
+   return FILE_CHECKED;
+}
+
+// process one file in all selected modes
+// st: status of the file, 0 if it cannot be stat'ed
+int process_file(const TAppConfig& ac, const char *name, const struct stat *st, CRC16& crc, FileResult& res) {
+   // ignore all files starting with ._ which are apple metafiles
+   {
+       tstring t = name;
+       t.extractFilename();
+       if((t[0] == '.') && (t[1] == '_'))
+	   return FILE_SKIPPED;
+   }
+
+   // stdin
+   if(strcmp(name, "-") == 0) return process_pipe(ac, name, crc, res);
+   
+   // check for file
+   if(st == 0) {
+      fmes(name, "%scan't stat file (dangling symbolic link?)%s\n", cerror, cnor);
+      return FILE_SKIPPED;
+   }
+   const struct stat& buf = *st;
+   if(S_ISDIR(buf.st_mode)) {
+      fmes(name, "%signoring directory%s\n", cerror, cnor);
+      return FILE_SKIPPED;
+   }
+   if(S_ISFIFO(buf.st_mode)) return process_pipe(ac, name, crc, res);
+   if(!S_ISREG(buf.st_mode)) {
+      fmes(name, "%signoring non regular file%s\n", cerror, cnor);
+      return FILE_SKIPPED;
+   }
+   off_t len = buf.st_size;
+
+   // open file
+   int flags = O_RDONLY;
+   int prot = PROT_READ;
+   if(!dummy) {
+      if(ac("fix-headers")||ac("cut-junk-start")||ac("fix-crc")||ac("cut-junk-end")||ac("cut-tag-end")||edit_frame_byte) {
+	 flags = O_RDWR;
+	 prot |= PROT_WRITE;
+	 if(nommap)
+	      userError("option --no-mmap does not yet support options which may modify a file (e.g --fix-crc)!\n");
+      }
+   }
+   flags |= O_BINARY;
+   int fd = open(name, flags);
+   if(fd==-1) {
+      perror("open");
+      userError("can't open file '%s' for reading!\n", name);      
+   }
+
+   // list needs only the head and the tail of the file
+   // (and with -B all frames, unless there is a vbr header)
+   bool head_tail = ac("list")||ac("compact-list")||ac("raw-list");
+
+   // mmap or read file
+   const unsigned char *p;
+   const unsigned char *free_p = 0;
+   unsigned char *ahead = 0;
+   if(read_ahead) read_ahead->take(name, buf, ahead);
+   
+   // page cache: remember the pages cached before and give hints
+   // (a file read ahead has been read and dropped already)
+   PageResidency *residency = 0;
+   if(!ahead) {
+      if(cache_policy & PAGES_DROP) residency = new PageResidency(fd, len);
+      advise_file(fd, len);
+   }
+   
+   if(ahead) {
+      // already read by a read ahead thread
+      free_p = p = ahead;
+   } else if(stream || head_tail) {
+      // the checks or the list read the file through a sliding window
+      p = NULL;
+   } else if(nommap) {
+       // read file
+       free_p = p = new unsigned char[len];
+       // read() returns at most 2GB at once
+       for(off_t done = 0; done < len; ) {
+	   ssize_t n = read(fd, (void*)(p + done), len - done);
+	   if(n <= 0) {
+	       perror("read");
+	       userError("error while reading file '%s'!\n", name);
+	   }
+	   done += n;
+       }
+   } else {
+       // mmap file
+       int map_flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+       if(cache_policy & PAGES_POPULATE) map_flags |= MAP_POPULATE;
+#endif
+       if(len) {
+	   free_p = p = (const unsigned char *) mmap(0, len, prot, map_flags, fd, 0);
+       } else {
+	   p = NULL;
+       }
+       if(p==(const unsigned char *)MAP_FAILED) {
+	   perror("mmap");
+	   userError("can't map file '%s'!\n", name);
+       }
+       if(len) advise_map(p, len);
+   }
+
+   // edit single byte of a frame
+   if(edit_frame_byte) {
+      if(progress) {
+	 tstring s = tstring(name).shortFilename(79);
+	 fprintf(stderr, "%-79.79s\r", s.c_str());
+	 fflush(stderr);
+      }	 
+      unsigned char *pp = const_cast<unsigned char *>(skip_n_frames(free_p, len, efb_frame));
+      if(pp) {
+	 if(!dummy) pp[efb_offset] = efb_value;
+      } else {
+	 fmes(name, "%sframe %s%d%s not found%s\n", cerror, cval, efb_frame, cerror, cnor);
+	 res.err++;
+      }	 	 
+   }      
+
+   // list
+   if(ac("list")||ac("compact-list")||ac("raw-list")) {
+      StreamWindow *in;
+      if(head_tail) in = new StreamWindow(fd, len, LIST_WINDOW_SIZE, name);
+      else          in = new StreamWindow(p, len);
+      off_t avail;
+      // speed up list of very large files (like *.wav)
+      off_t maxl = LIST_MAX_HEADER_SEARCH;
+      off_t start = find_next_header(*in, 0, len<maxl?len:maxl, MIN_VALID);
+      if(start<0) {
+	 if(!ign_noamp) {
+	    if(ac("raw-list")) {
+	       mprintf("%s%c%s%c%c", (len?"invalid_stream":"empty_stream"), rawsep, name, rawsep, rawlinesep);
+	    } else if(ac("compact-list")) {
+	       mprintf("%s%-25s%s%s %s%s%s\n", cerror, (len?"not an audio mpeg stream":"empty file"), cnor, (columns>=82?"  ":""), cfil, name, cnor);
+	    } else {	       
+	       fmes(name, "%s%s%s\n", cerror, (len?"not an audio mpeg stream":"empty file"), cnor);
+	    }
+	    res.err++;
+	 }
+      } else {
+	 Header h = get_header(in->data(start, 4, avail));
+	 bool vbr = false;
+	 unsigned short int avgbr;
+	 unsigned int l_min = (ign_bit?stream_duration(*in, &vbr, &avgbr):len/(h.bitrate()/8));
+	 unsigned int l_mil = l_min%1000;
+	 l_min/=1000;
+	 unsigned int l_sec = l_min%60;
+	 l_min/=60;
+	 tstring l_str;
+	 if(l_min >= 60)
+	   l_str.sprintf("%2u:%02u", l_min/60, l_min%60);
+	 else 
+	   l_str.sprintf("   %2u", l_min);
+	 Tagv1 *tag=new Tagv1;
+	 unsigned short int tag_version=0;
+	 if(len>=128) {
+	    tag->setTarget(in->data(len-128, 128, avail));
+	    if(tag->isValid())
+	      tag_version=tag->version();
+	 }
+	 if(ac("list")) {
+	    unsigned int xwidth = 0;
+	    tstring n = single_line?tstring(name):tstring(name).shortFilename(columns-1);
+	    fmes(name, "mpeg %s%3.1f%s layer %s%d%s %s%2.1f%skHz %s%3d%skbps",
+		   h.version()==1.0?cval:cano, h.version(), cnor, 
+		   h.layer()==3?cval:cano, h.layer(), cnor, 
+		   h.samp_rate()==44.1?cval:cano, h.samp_rate(), cnor, 
+		   (h.bitrate()==128&&!vbr)?cval:cano, vbr?avgbr:h.bitrate(), cnor);
+	    if(ign_bit && columns>=83) {
+	       mprintf(" %s%s%s",
+		      vbr?cano:cval,vbr?"VBR":"CBR",cnor);
+	       xwidth+=4;
+	    } 
+	    mprintf(" %s%-12.12s%s %s%-7.7s%s %s%s%s %s%s%s %s%s%s %s%s:%02u.%02u%s",
+		   h.mode==Header::JOINT_STEREO?cval:cano, h.mode_str(), cnor,
+		   h.emphasis==Header::emp_NONE?cval:cano, h.emphasis_str(), cnor,
+		   h.protection_bit?cano:cval, h.protection_bit?"---":"crc", cnor, 
+		   h.original?cval:cano, h.original?"orig":"----", cnor,
+		   cval, h.copyright?"copy":"----", cnor,
+		   cval, l_str.c_str(), l_sec, l_mil/10, cnor);
+	    if(columns>=87+xwidth) {
+	      if(tag_version)
+		mprintf(" id3 %s%1u.%1u%s", cval, tag_version>>8,
+		       tag_version&0xff,cnor);
+//		 xwidth+=8;
+	    }
+	    mprintf("\n");
+	 } else if(ac("compact-list")) {
+	    unsigned int xwidth = 0;
+	    mprintf("%s%c%s%s%d%s %s%2.0f%s %s%3d%s",
+		   h.version()==1.0?cval:cano, h.version()==1.0?'l':'L', cnor, 
+		   h.layer()==3?cval:cano, h.layer(), cnor, 
+		   h.samp_rate()==44.1?cval:cano, h.samp_rate(), cnor, 
+		   (h.bitrate()==128&&!vbr)?cval:cano, vbr?avgbr:h.bitrate(), cnor);
+	    if(ign_bit && columns>=80) {
+	       mprintf("%s%c%s",
+		      vbr?cano:cval, vbr?'V':' ', cnor);
+	       xwidth+=1;
+	    }
+	    mprintf(" %s%s%s %s%s%s %s%s%s%s%s%s%s%s%s",
+		   h.mode==Header::JOINT_STEREO?cval:cano, h.short_mode_str(), cnor,
+		   h.emphasis==Header::emp_NONE?cval:cano, h.short_emphasis_str(), cnor,
+		   h.protection_bit?cano:cval, h.protection_bit?"-":"C", cnor, 
+		   h.original?cval:cano, h.original?"O":"-", cnor,
+		   cval, h.copyright?"Y":"-", cnor);
+	    if(columns>=81+xwidth) {
+	      if(tag_version)
+		mprintf(" %s%1u%s",cval,tag_version>>8,cnor);
+	      else
+		mprintf(" %s-%s",cval,cnor);
+	      xwidth+=2;
+	    }
+	    tstring n = tstring(name).shortFilename(columns-(26+xwidth));
+	    n.replaceUnprintable(only_ascii);
+	    mprintf(" %s%3u:%02u%s %s%s%s\n",
+		   cval, l_min, l_sec, cnor, cfil, n.c_str(), cnor);  
+	 } else if(ac("raw-list")) {	       
+	    mprintf("valid_stream%c%.1f%c%d%c%.1f%c%d%c%s%c%s%c%s%c%s%c%s%c%s%c%u%c%u%c%u%c%s%c%c",
+		   rawsep,
+		   h.version(), rawsep,
+		   h.layer(), rawsep, 
+		   h.samp_rate(), rawsep,
+		   vbr?avgbr:h.bitrate(), rawsep,
+		   ign_bit?(vbr?"VBR":"CBR"):"?", rawsep,
+		   h.mode_str(), rawsep,
+		   h.emphasis_str(), rawsep,
+		   h.protection_bit?"---":"crc", rawsep,
+		   h.original?"orig":"copy", rawsep,
+		   h.copyright?"cprgt":"-----", rawsep,
+		   l_min, rawsep, 
+		   l_sec, rawsep, 
+		   l_mil, rawsep,
+		   name, rawsep, rawlinesep);
+	 }
+	 delete tag;
+      }
+      delete in;
+   }
+
+   // cut-junk-start
+   if(ac("cut-junk-start")) {
+      off_t start = find_next_header(p, len, MIN_VALID);
+      if(start<0) {
+	 fmes(name, "%s%s%s\n", cerror, (len?"not an audio mpeg stream":"empty file"), cnor);
+	 res.err++;
+      } else if(start==0) {
+	 fmes(name, "%scut-junk-start: no junk found%s\n", cok, cnor);	    
+      } else {
+	 fmes(name, "%scut-junk-start: removing first %s%lld%s byte%s, %sretrying%s\n",
+	      cok, cval, (long long)start, cok, (start>1)?"s":"", dummy?"not (due to dummy) ":"", cnor);
+	 if(!dummy) {
+	    // move start to begining and truncate the file
+	    memmove((char*)free_p, free_p + start, len - start);
+	    if(munmap((char*)free_p, len)) {
+	       perror("munmap");
+	       userError("can't unmap file '%s'!\n", name);
+	    }
+	    len-=start;
+#ifndef __STRICT_ANSI__
+	    if(ftruncate(fd, len) < 0) {
+	       perror("ftruncate");
+	    }
+#else
+	    userError("cannot truncate file since this executable was compiled with __STRICT_ANSI__ defined!\n");
+#endif
+	    close(fd);      
+	    delete residency;
+
+	    // retry this file 
+	    return FILE_RETRY;
+	 }
+      }
+   }
+
+   // cut-tag-end
+   if(ac("cut-tag-end")) {
+      // lots of side effects: perhaps unmaps and closes file
+      if(cut_tag_end(name, p, len, fd, res.err)) {
+	 // retry this file if not dummy
+	 if(!dummy) {
+	    delete residency;
+	    return FILE_RETRY;
+	 }
+      }
+   }
+
+   // cut-junk-end
+   if(ac("cut-junk-end")) {
+      // lots of side effects: perhaps unmaps and closes file
+      if(cut_junk_end(name, p, len, free_p, fd, res.err)) {
+	 // retry this file if not dummy
+	 if(!dummy) {
+	    delete residency;
+	    return FILE_RETRY;	   
+	 }	   
+      }
+   }
+
+   // check for errors and anomalies
+   StreamWindow *in;
+   if(stream && !ahead) in = new StreamWindow(fd, len, STREAM_WINDOW_SIZE, name);
+   else                 in = new StreamWindow(p, len);
+   check_stream(ac, name, *in, crc, res);
+   delete in;
+
+   // dump header
+   if(ac("dump-header")) {
+      fmes(name, "\n");
+      for(off_t k=0; k<len-3; p++, k++) {
+	 if(*p==255) {
+	    Header h;	       
+	    h = get_header(p);
+	    if(h.syncword==0xfff) {
+	       tstring s=h.print();
+	       mprintf("%7lld %s\n", (long long)k, s.c_str());
+	       int l = frame_length(h);
+	       if(l>=21) {
+		  p+=l;
+		  p--;
+		  k+=l;
+		  k--;
+	       }
+	    }
+	 }
+      }
+   }      
+
+   // dump tag
+   if(ac("dump-tag")) {
+      unsigned int err_thisfile=0;
+      fmes(name, "\n");
+      Tagv1 *tag=new Tagv1;
+      for(off_t k=0; k<len-127; k++) {
+	 tag->setTarget(p+k);
+	 if(tag->isValidGuess()) {
+	    mprintf("  Found at: %s0x%08llx%s (%s%s%s)\n", cval, (unsigned long long)k, cnor,
+		   (k==len-128?cok:cerror),
+		   ((k==len-128)||!(++err_thisfile)?"end":"in the stream"), cnor);
+	    tag->fillFields();
+	    mprintf("  Version: %s%u.%u%s\n", cval, tag->fields_version>>8,
+		   tag->fields_version&0xff, cnor);
+	    mprintf("  Conforms to specification: %s%s%s\n",
+		   (tag->isValidSpecs()&&!tag->fields_spacefilled?cok:cerror),
+		   (tag->isValidSpecs()||!(++err_thisfile)?(tag->fields_spacefilled?"space filled":"yes"):"no"),
+		   cnor);
+	    mprintf("  Title: \"%s%s%s\"\n", cval, tag->field_title, cnor);
+	    mprintf("  Artist: \"%s%s%s\"\n", cval, tag->field_artist, cnor);
+	    mprintf("  Album: \"%s%s%s\"\n", cval, tag->field_album, cnor);
+	    mprintf("  Year: \"%s%s%s\"\n", cval, tag->field_year, cnor);
+	    mprintf("  Comment: \"%s%s%s\"\n", cval, tag->field_comment, cnor);
+	    if(tag->field_genre==0xff) // not set
+	       mprintf("  Genre: not set\n");
+	    else
+	    {
+	       mprintf("  Genre: %s%s%s\n", ((tag->field_genre>=Tagv1::genres_count)?cerror:cval),
+		      ((tag->field_genre<Tagv1::genres_count)?(Tagv1::id3_genres[tag->field_genre]):"unknown"),
+		      cnor);
+	    }
+	    if(tag->field_track)
+	       mprintf("  Track: %s%u%s\n", cval, tag->field_track, cnor);
+	    k+=2;
+	 }
+      }
+      delete tag;
+      if(err_thisfile) ++res.err;
+   }
+
+    // --add-id3
+    bool addTag = false;
+    if(ac("add-tag"))
+    {
+	if(progress) {
+	    tstring s = tstring(name).shortFilename(79);
+	    fprintf(stderr, "%-79.79s\r", s.c_str());
+	    fflush(stderr);
+	}
+	// check for existing tag
+	if(checkForID3V1(p, len))
+	{
+	    if(ac("verbose"))
+		fmes(name, "id3 tag v1.x found, not adding anything\n");
+	}
+	else if(checkForID3V2(p, len))
+	{
+	    if(ac("verbose"))
+		fmes(name, "id3 tag v2.x found, not adding anything\n");
+	}
+#if 0	   
+	// this wqs just here to make sure we do not mis something
+	else if(checkForTagsSloppy(p, len))
+	{
+	    fmes(name, "some tag found\n");	       
+	}
+#endif	   
+	else
+	{
+	    // no tag found: add tag
+	    addTag = true;
+	}
+    }
+
+   if(nommap || ahead) {
+       // free mem
+       delete[] free_p;
+   } else {
+       // unmap file and close
+       if((free_p!=NULL)&&munmap((char*)free_p, len)) {
+	   perror("munmap");
+	   userError("can't unmap file '%s'!\n", name);
+       }
+   }
+   // drop the pages read by the check
+   if(residency) {
+      residency->drop(fd);
+      delete residency;
+   }
+    // close file
+   close(fd);       
+
+    // add tag? (see above)
+    if(addTag)
+    {	   
+	// extract data from filename
+	tstring title;  // 30
+	tstring artist; // 30
+	tstring album;  // 30
+	tstring comment;// 28
+	char track = 0;     // 1
+	tstring fname = name;
+	fname.translateChar('_', ' ');
+	fname.searchReplace("cd 1", "cd1");
+	fname.searchReplace("cd 2", "cd2");
+	fname.searchReplace("cd 3", "cd3");
+	fname.searchReplace("cd 4", "cd4");
+	fname.searchReplace(" - ms/disc1/", "/cd1 - ");
+	fname.searchReplace(" - ms/disc2/", "/cd2 - ");
+	fname.searchReplace("/cd1/", " - cd1/");
+	fname.searchReplace("/cd2/", " - cd2/");
+	fname.searchReplace("/cd3/", " - cd3/");
+	fname.searchReplace("/cd4/", " - cd4/");
+	fname.searchReplace("zance - a decade of dance from ztt", "zance decade of dance from ztt");
+	fname.searchReplace("/captain future soundtrack - ", "/");
+	fname.searchReplace("-ms/", "/");
+	fname.collapseSpace();
+	title = fname;
+	album = fname;
+	comment = fname;
+	title.extractFilename();
+	album.extractPath();
+	album.removeDirSlash();
+	album.extractFilename();
+	comment.extractPath();
+	comment.removeDirSlash();
+	comment.extractPath();
+	comment.removeDirSlash();
+	comment.extractFilename();
+
+	// title
+	// remove album
+	if(title != album)
+	    title.searchReplace(album, "");
+	// remove .mp3
+	if((title.length() >= 4) && strcasecmp(title.c_str() + title.length(), ".mp3"))
+	    title.truncate(title.length() - 4);
+	// check for cd1 - 
+	if((strcasecmp(title.substr(0, 3).c_str(), "CD1") == 0) ||
+	   (strcasecmp(title.substr(0, 3).c_str(), "CD1") == 0) ||
+	   (strcasecmp(title.substr(0, 3).c_str(), "CD2") == 0))
+	{
+	    album += " " + title.substr(0,3);
+	    title = title.substr(3);
+	    // skip separator
+	    while(strchr(" -.", title.c_str()[0])) 
+		title = title.substr(1);
+	}
+	// check for AA-TT format
+	if(isdigit(title[0]) && isdigit(title[1]) && isdigit(title[3]) && isdigit(title[4]) && (title[2] == '-'))
+	{
+	    album += " cd" + title.substr(1,2);
+	    title = title.substr(3);
+	}
+	// check for 'audio '
+	tstring ltitle = title;
+	ltitle.lower();
+	if(ltitle.substr(0, 5) == "audio")
+	    title = title.substr(5) + " " + title.substr(0, 5);
+	else if(ltitle.substr(0, 10) == "track cd -")
+	{
+	    title = title.substr(10);
+	    album += " track cd";
+	}
+	else if(ltitle.substr(0, 8) == "mix cd -")
+	{
+	    title = title.substr(8);
+	    album += " mix cd";
+	}
+	else if(ltitle.substr(0, 6) == "track-")
+	    title = title.substr(6) + " " + title.substr(0, 6);
+	else if(ltitle.substr(0, 5) == "track")
+	    title = title.substr(5) + " " + title.substr(0, 5);
+	title.cropSpace();
+	title.collapseSpace();
+
+	// scan track
+	size_t pos = 0;
+	while(isdigit(title.c_str()[pos])) pos++;
+	if((pos >= 1) && (pos <=2))
+	{
+	    int t = 0;
+	    title.substr(0, pos).toInt(t, 10);
+	    track = t;	       
+	}
+	else if(pos > 2)
+	    pos = 0;
+	// skip separator
+	while(strchr(" -.", title.c_str()[pos])) pos++;
+	title = title.substr(pos);
+	// split artist - title
+	splitArtistTitle(title, artist, title);
+	title.cropSpace();
+
+	// album
+	tstring ar;
+	// split artist - album
+	if((album == "alben") ||
+	   (album == "cdrom2") ||
+	   (album == "cdrom") ||
+	   (album == "misc1") ||
+	   (album == "mp3") ||
+	   (album == "ov") ||
+	   (album == "all"))
+	    album = "";
+	splitArtistTitle(album, ar, album);
+	if((!artist.empty()) && (!ar.empty()))
+	{
+	    if(artist != ar)
+	    {
+		title = artist + "-" + title;
+		artist = ar;
+	    }
+	}
+	else if(artist.empty())
+	{
+	    artist = ar;
+	    ar = "";
+	}
+	if(artist.empty())
+	{
+	    artist = album;
+	    album = "";
+	}
+	album.cropSpace();
+	artist.cropSpace();
+	if(artist == "diverse")
+	    artist = "";
+
+	// comment
+	comment.cropSpace();
+	if((comment == "alben") ||
+	   (comment == "cdrom2") ||
+	   (comment == "cdrom") ||
+	   (comment == "mp3") ||
+	   (comment == "ov") ||
+	   (comment == "chr music") ||
+	   (comment == "mp3 dl") ||
+	   (comment == "diverse") ||
+	   (comment.substr(0, 2) == "M0") ||
+	   (comment.substr(0, 7) == "Unknown") ||
+	   (comment.substr(0, 7) == "Various") ||
+	   (comment == "all"))
+	    comment = "";
+
+	// capitalize strings
+	capitalize(title);
+	capitalize(artist);
+	capitalize(album);
+	capitalize(comment);
+
+	// move rest of long strings into comment
+	if(title.length() > 30)
+	    title.searchReplace(" - ", "-");
+	if(artist.length() > 30)
+	    artist.searchReplace(" - ", "-");
+	if(album.length() > 30)
+	    album.searchReplace(" - ", "-");
+	if(title.length() > 30)
+	{
+	    comment = "T:" + title.substr(30);
+	    title.truncate(30);
+	}
+	if(artist.length() > 30)
+	{
+	    comment = "R:" + artist.substr(30);
+	    artist.truncate(30);
+	}
+	if(album.length() > 30)
+	{
+	    comment = "L:" + album.substr(30);
+	    album.truncate(30);
+	}
+
+	// print and check tag
+//	   fmes(name, "appending id3 tag v1.1:\ntitle=  '%s%s%s'\nartist= '%s%s%s'\nalbum=  '%s%s%s'\ncomment='%s%s%s'\ntrack=  %s%d%s\n", 
+//		cval, title.c_str(), cnor, cval, artist.c_str(), cnor, cval, album.c_str(), cnor, cval, comment.c_str(), cnor, cval, track, cnor);
+	fmes(name, "'%s%-30.30s%s' '%s%-30.30s%s' '%s%-30.30s%s' '%s%-28.28s%s' %s%d%s\n",
+	     cval, title.c_str(), cnor, cval, artist.c_str(), cnor, cval, album.c_str(), cnor, cval, comment.c_str(), cnor, cval, track, cnor);
+	if(title.length() > 30)
+	    mprintf("%swarning%s: title > 30 chars\n", cerror, cnor);
+	if(artist.length() > 30)
+	    mprintf("%swarning%s: artist > 30 chars\n", cerror, cnor);
+	if(album.length() > 30)
+	    mprintf("%swarning%s: album > 30 chars\n", cerror, cnor);
+	if(comment.length() > 28)
+	    mprintf("%swarning%s: comment > 28\n", cerror, cnor);
+	if(track == 0)
+	    mprintf("%swarning%s: no track\n", cerror, cnor);
+
+	// write tag
+	char tag[128];
+	memset(tag, 0, 128);
+	tag[0] = 'T';
+	tag[1] = 'A';
+	tag[2] = 'G';
+	strncpy(tag + 3, title.c_str(), 30);
+	strncpy(tag + 3 + 30, artist.c_str(), 30);
+	strncpy(tag + 3 + 60, album.c_str(), 30);
+	strncpy(tag + 3 + 90 + 4, comment.c_str(), 28);
+	tag[126] = track;
+	tag[127] = -1;
+	res.tagadded = true;
+#if 1
+	if(!dummy)
+	{
+	    // append to file
+	    FILE *f = fopen(name, "ab");
+	    if(f == 0)
+		userError("can't open file '%s' for writing!\n", name);
+	    if(fwrite(tag, 1, 128, f) != 128)
+		userError("error while writing to file '%s'\n", name);
+	    fclose(f);
+	}
+#endif
+    }
+
+   return FILE_CHECKED;
+}
+
+
+// --cache: everything which changes the messages or the result of a check
+tstring cache_signature(const TAppConfig& ac) {
+   char buf[256];
+   snprintf(buf, sizeof(buf), "version=%s e=%d a=%d m=%d ign=%d%d%d%d%d%d%d%d%d any=%d%d%d%d%d%d%d "
+	    "valid=%d single=%d quiet=%d ascii=%d columns=%u color=%d%d format=%d verdict=%d",
+	    VERSION, ac("error-check"), ac("anomaly-check"), max_errors,
+	    ign_crc, ign_start, ign_end, ign_tag, ign_bit, ign_const, ign_trunc, ign_noamp, ign_sync,
+	    ano_any_crc, ano_any_bit, ano_any_emp, ano_any_rate, ano_any_mode, ano_any_layer, ano_any_ver,
+	    show_valid_files, single_line, quiet, only_ascii, columns, ac("color"), ac("alt-color"), output_format, verdict_only);
+   return buf;
+}
+
+// process_file() with --cache: unchanged files report their cached result
+int check_cached(const TAppConfig& ac, const char *name, const struct stat& buf, CRC16& crc, FileResult& res) {
+   if((cache == 0) || !S_ISREG(buf.st_mode))
+     return process_file(ac, name, &buf, crc, res);
+   TFileInstance inst(dev_t2mydev_t(buf.st_dev), buf.st_ino);
+   ResultCache::Entry e;
+   if(cache->lookup(inst, name, buf, e)) {
+      mprintf("%s", e.text.c_str());
+      res.err = e.err;
+      res.ano = e.ano;
+      res.log = e.log;
+      return FILE_CHECKED;
+   }
+   
+   // check and remember the messages
+   file_capture = &e.text;
+   int r = process_file(ac, name, &buf, crc, res);
+   format_events(current_output());
+   file_capture = 0;
+   if(r == FILE_CHECKED) {
+      e.name = name;
+      e.setStatus(buf);
+      e.err = res.err;
+      e.ano = res.ano;
+      e.log = res.log;
+      cache->store(inst, e);
+   }
+   return r;
+}
+
+
+// files with several hard links: the result of the first path in the file list
+struct LinkResult {
+   LinkResult(): index(0), nlink(0), taken(0), waiting(0), done(false), r(FILE_SKIPPED) {}
+   tstring name;
+   size_t index;   // index of the first path in the file list
+   nlink_t nlink;  // number of links of the file
+   nlink_t taken;  // number of paths which got the result
+   int waiting;    // number of paths waiting for the result
+   bool done;      // the first path has been checked
+   int r;
+   FileResult res;
+};
+tmap<TFileInstance,LinkResult> link_results;
+tmap<size_t,TFileInstance> link_order; // the files of link_results by index of their first path
+size_t links_seen = 0;         // all files before this index have been seen
+tmap<size_t,bool> links_ahead; // files behind links_seen which have been seen
+pthread_mutex_t link_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t link_cond = PTHREAD_COND_INITIALIZER;
+
+
+// note that the file with index i of the file list has been seen (with link_mutex)
+void link_seen(size_t i) {
+   if(i < links_seen) return; // FILE_RETRY
+   links_ahead[i] = true;
+   while(links_ahead.contains(links_seen)) 
+      links_ahead.erase(links_seen++);
+   pthread_cond_broadcast(&link_cond);
+}
+
+
+// a path of file inst got its result (with link_mutex): the result is
+// dropped when all links of the file got it
+void link_taken(const TFileInstance& inst) {
+   LinkResult& l = link_results[inst];
+   if((++l.taken < l.nlink) || l.waiting) return; // a path may be given twice
+   link_order.erase(l.index);
+   link_results.erase(inst);
+}
+
+
+// keep at most MAX_LINK_RESULTS results (with link_mutex): the oldest
+// results nobody waits for are dropped, their remaining links are outside
+// the checked files (or checked again if they show up later)
+void link_limit() {
+   tmap<size_t,TFileInstance>::iterator i = link_order.begin();
+   while((link_results.size() > MAX_LINK_RESULTS) && (i != link_order.end())) {
+      LinkResult& l = link_results[i->second];
+      if(l.done && (l.waiting == 0)) {
+	 link_results.erase(i->second);
+	 link_order.erase(i++);
+      } else {
+	 ++i;
+      }
+   }
+}
+
+
+// check file i of the file list, it is stat'ed once here unless the file 
+// list knows its status
+// a file with several hard links is only checked once: the first of its
+// paths in the file list is checked (--jobs: files with several hard links
+// wait until all previous files have been seen), the other paths report 
+// the result of the first path, the result is kept until all links of the
+// file have been seen
+int check_file(const TAppConfig& ac, const FileName& file, size_t i, CRC16& crc, FileResult& res) {
+   const char *name = file.name.c_str();
+   struct stat buf;
+   bool stated = true;
+   if(file.stated) buf = file.st;
+   else stated = (stat(name, &buf) == 0);
+   if(!dedup_links || !stated || !S_ISREG(buf.st_mode) || (buf.st_nlink < 2)) {
+      if(dedup_links) {
+	 pthread_mutex_lock(&link_mutex);
+	 link_seen(i);
+	 pthread_mutex_unlock(&link_mutex);
+      }
+      if(!stated) return process_file(ac, name, 0, crc, res);
+      return check_cached(ac, name, buf, crc, res);
+   }
+   
+   TFileInstance inst(dev_t2mydev_t(buf.st_dev), buf.st_ino);
+   pthread_mutex_lock(&link_mutex);
+   while(links_seen < i)
+      pthread_cond_wait(&link_cond, &link_mutex);
+   link_seen(i);
+   if(link_results.contains(inst) && (link_results[inst].index != i)) {
+      // wait for the first path (it may still be checked by another job)
+      LinkResult& l = link_results[inst];
+      ++l.waiting;
+      while(!l.done)
+	 pthread_cond_wait(&link_cond, &link_mutex);
+      --l.waiting;
+      tstring first = l.name;
+      int r = l.r;
+      res = l.res;
+      if(r != FILE_RETRY) link_taken(inst);
+      pthread_mutex_unlock(&link_mutex);
+      res.tagadded = false;
+      if(r == FILE_CHECKED) {
+	 if(res.err || res.ano || show_valid_files)
+	   fmes(name, "same as %s%s%s\n", cfil, first.c_str(), cnor);
+      }
+      return r;
+   }
+   if(!link_results.contains(inst)) {
+      link_order[i] = inst;
+      link_results[inst].nlink = buf.st_nlink;
+   }
+   LinkResult& first = link_results[inst];
+   first.name = name;
+   first.index = i;
+   first.done = false; // FILE_RETRY
+   link_limit();
+   pthread_mutex_unlock(&link_mutex);
+   
+   int r = check_cached(ac, name, buf, crc, res);
+   
+   pthread_mutex_lock(&link_mutex);
+   LinkResult& l = link_results[inst];
+   l.r = r;
+   l.res = res;
+   l.done = true;
+   if(r != FILE_RETRY) link_taken(inst);
+   pthread_cond_broadcast(&link_cond);
+   pthread_mutex_unlock(&link_mutex);
+   return r;
+}
+
+
+// reorder buffer slot: output and result of one file (--jobs)
+struct JobSlot {
+   JobSlot(): r(FILE_SKIPPED), done(false) {}
+   FileOutput out;
+   FileResult res;
+   int r;                      // return value of process_file()
+   bool done;
+};
+
+
+// shared state of the worker threads for --jobs
+struct JobQueue {
+   const TAppConfig *ac;
+   FileList *filelist;
+   pthread_mutex_t mutex;      // protects next, flushed, end and JobSlot::done
+   pthread_cond_t cond;        // signalled whenever a file is done or printed
+   tvector<JobSlot> slots;     // file i uses slot i % slots.size()
+   size_t next;                // index of the next file to check
+   size_t flushed;             // all files before this index are printed
+   bool end;                   // the file list is exhausted (or the verdict is known)
+};
+
+
+// called by vmprintf() if the output buffer of a file grows too large:
+// wait until all previous files are printed, then print directly
+void flush_file_output(FileOutput& out) {
+   if(out.queue == 0) {
+      // sequential check: nothing else writes to stdout
+      fwrite(out.text.c_str(), 1, out.text.len(), stdout);
+      out.text.clear();
+      return;
+   }
+   JobQueue& q = *out.queue;
+   pthread_mutex_lock(&q.mutex);
+   while(q.flushed != out.index)
+      pthread_cond_wait(&q.cond, &q.mutex);
+   pthread_mutex_unlock(&q.mutex);
+   // the writer waits for this file to be done, so we may write now
+   fwrite(out.text.c_str(), 1, out.text.len(), stdout);
+   out.text.clear();
+}
+
+
+// worker thread: check files until the file list is exhausted
+void *check_worker(void *arg) {
+   JobQueue& q = *(JobQueue *)arg;
+   CRC16 crc(CRC16::CRC_16);
+   for(;;) {
+      // get next file, but do not run more than slots.size() files ahead of the output
+      pthread_mutex_lock(&q.mutex);
+      while(!q.end && (q.next >= q.flushed + q.slots.size()))
+	 pthread_cond_wait(&q.cond, &q.mutex);
+      size_t i = q.next++;
+      bool end = q.end;
+      pthread_mutex_unlock(&q.mutex);
+      FileName file;
+      if(end || !q.filelist->get(i, file)) {
+	 pthread_mutex_lock(&q.mutex);
+	 q.end = true;
+	 pthread_cond_broadcast(&q.cond);
+	 pthread_mutex_unlock(&q.mutex);
+	 break;
+      }
+      
+      // check file into its slot
+      JobSlot& slot = q.slots[i % q.slots.size()];
+      slot.out.queue = &q;
+      slot.out.index = i;
+      file_output = &slot.out;
+      slot.r = check_file(*q.ac, file, i, crc, slot.res);
+      format_events(slot.out);
+      file_output = 0;
+      if(read_ahead) read_ahead->release(i);
+      
+      pthread_mutex_lock(&q.mutex);
+      slot.done = true;
+      // --verdict-only: the exit status is known, do not start more files
+      if(verdict_only && (slot.res.err || slot.res.ano)) q.end = true;
+      pthread_cond_broadcast(&q.cond);
+      pthread_mutex_unlock(&q.mutex);
+   }
+   return 0;
+}
+
+
+// check all files with n worker threads, print the output of the files in 
+// the order of the file list and update totals
+void check_parallel(const TAppConfig& ac, FileList& filelist, int n, bool show_progress, FILE *log,
+		    int& err, int& checked, int& num_ano, int& num_tagsadded) {
+   JobQueue q;
+   q.ac = &ac;
+   q.filelist = &filelist;
+   q.slots = tvector<JobSlot>(n * JOB_WINDOW);
+   q.next = 0;
+   q.flushed = 0;
+   q.end = false;
+   pthread_mutex_init(&q.mutex, 0);
+   pthread_cond_init(&q.cond, 0);
+   tvector<pthread_t> threads(n);
+   for(int i = 0; i < n; i++)
+      if(pthread_create(&threads[i], 0, check_worker, &q))
+	userError("can't create worker thread!\n");
+   
+   // writer: print files in order
+   FileName file;
+   for(size_t i = 0; filelist.get(i, file); i++) {
+      JobSlot& slot = q.slots[i % q.slots.size()];
+      pthread_mutex_lock(&q.mutex);
+      while(!slot.done)
+	 pthread_cond_wait(&q.cond, &q.mutex);
+      pthread_mutex_unlock(&q.mutex);
+      
+      if(show_progress) {
+	 tstring s = tstring(file.name).shortFilename(79);
+	 fprintf(stderr, "%-79.79s\r", s.c_str());
+	 fflush(stderr);
+      }
+      fwrite(slot.out.text.c_str(), 1, slot.out.text.len(), stdout);
+      err += slot.res.err;
+      if(slot.res.ano) ++num_ano;
+      if(slot.res.tagadded) ++num_tagsadded;
+      if(slot.res.log && log) fprintf(log, "%s\n", file.name.c_str());
+      if(slot.r == FILE_CHECKED) ++checked;
+      filelist.forget(i + 1);
+      
+      // free slot
+      slot.out.text.clear();
+      slot.out.lastname.clear();
+      slot.res = FileResult();
+      pthread_mutex_lock(&q.mutex);
+      slot.done = false;
+      q.flushed = i + 1;
+      pthread_cond_broadcast(&q.cond);
+      pthread_mutex_unlock(&q.mutex);
+      // the exit status is known, the workers do not start more files
+      if(verdict_only && (err || num_ano)) break;
+   }
+   
+   for(int i = 0; i < n; i++)
+      pthread_join(threads[i], 0);
+   pthread_cond_destroy(&q.cond);
+   pthread_mutex_destroy(&q.mutex);
+   if(show_progress) {
+      fputs("\r                                                                              \r", stderr);
+      fflush(stderr);
+   }
+}
+
+
+// print the summary below all messages
+void print_totals(const TAppConfig& ac, int checked, int err, int num_ano, int num_tagsadded) {
+   if(output_format == FORMAT_NDJSON) {
+      printf("{\"type\":\"total\",\"checked\":%d,\"erroneous\":%d,\"anomalous\":%d}\n", checked, err, num_ano);
+      return;
+   }
+   printf("--                                                                             \n"
+	  "%s%d%s file%s %s, %s%d%s erroneous file%s found\n", 
+	  cval, checked, cnor, checked==1?"":"s", 
+	  ac("list")?"listed":"checked", cval, err, cnor, err==1?"":"s");
+   if(num_ano) printf("(%s%d%s %sanomal%s%s found)\n", 
+		      cval, num_ano, cnor, cano, num_ano==1?"y":"ies", cnor);
+   if(num_tagsadded)
+     printf("(%s%d%s tags added)\n", 
+	    cval, num_tagsadded, cnor);
+}
+
+
+// print the stream parameters of a file in a binary log (--verbose)
+void print_log_info(const char *name, const CheckSummary& sum) {
+   if(sum.header == 0) return;
+   Header h = int_header(sum.header);
+   fmes(name, "mpeg %s%3.1f%s layer %s%d%s %s%2.1f%skHz", 
+	cval, h.version(), cnor, cval, h.layer(), cnor, cval, h.samp_rate(), cnor);
+   if(sum.avg_bitrate) mprintf(" %s%3d%skbps %s%s%s", cval, sum.avg_bitrate, cnor, cval, sum.vbr?"VBR":"CBR", cnor);
+   if(sum.max_bitrate) mprintf(" (%s%d%s-%s%d%s)", cval, sum.min_bitrate, cnor, cval, sum.max_bitrate, cnor);
+   if(sum.frames >= 0) {
+      unsigned int t = (unsigned int)(sum.time/1000);
+      mprintf(" %s%d%s frames %s%u:%02u%s", cval, sum.frames, cnor, cval, t/60, t%60, cnor);
+   }
+   mprintf("\n");
+}
+
+
+// --read-binary-log: print the files and events of all binary logs given
+// on the command line like the check printed them, return the exit code
+int read_binary_logs(const TAppConfig& ac) {
+   int checked = 0;
+   int err = 0;
+   int num_ano = 0;
+   for(size_t i = 0; i < ac.numParam(); i++) {
+      BinaryLogReader log(ac.param(i));
+      BinaryLog::File file, next;
+      Event e;
+      bool have_file = false;
+      for(;;) {
+	 int r = log.next(next, e);
+	 if(r == BinaryLogReader::EVENT_RECORD) {
+	    if(have_file) report(file.name.c_str(), e);
+	    continue;
+	 }
+	 // end of the previous file
+	 if(have_file && (output_format == FORMAT_NDJSON)) print_summary_json(file.name.c_str(), file.sum);
+	 flush_stdout_output();
+	 if(r == BinaryLogReader::END) break;
+	 file = next;
+	 have_file = true;
+	 ++checked;
+	 if(file.sum.error) ++err;
+	 if(file.sum.anomaly) ++num_ano;
+	 if(ac("verbose") && (output_format == FORMAT_TEXT)) print_log_info(file.name.c_str(), file.sum);
+      }
+   }
+   if((checked>1) && (!ac("no-summary")) && (!quiet))
+     print_totals(ac, checked, err, num_ano, 0);
+   return (err || num_ano)?1:0;
+}
+
+
 // main
 int main(int argc, char *argv[]) {      
 
    // get parameters
    TAppConfig ac(options, "options", argc, argv, 0, 0, VERSION);
+   init_frame_tab();
+   // messages of the current file when stopped by an error
+   atexit(flush_stdout_output);
    
    // get the terminal width if available
    struct winsize win;
@@ -1356,11 +3458,28 @@ int main(int argc, char *argv[]) {
    dummy = ac("dummy");
    progress = ac("progress");
    max_errors = ac.getInt("max-errors");
+   jobs = ac.getInt("jobs");
    show_valid_files = ac("show-valid");
-   bool nommap = ac("no-mmap");
+   dedup_links = streaming_modes_only(ac) && !ac("all-links");
+   nommap = ac("no-mmap");
+   stream = ac("stream");
+   verdict_only = ac("verdict-only");
+   if(verdict_only) {
+      // modes which modify or list files
+      static const char *other_modes[] = {"fix-headers", "fix-crc", "cut-junk-start", "cut-junk-end", "cut-tag-end",
+	 "add-tag", "dump-header", "dump-tag", "list", "compact-list", "raw-list", 0};
+      for(int i = 0; other_modes[i]; i++)
+	if(ac(other_modes[i]))
+	  userError("option --verdict-only can not be used together with --%s!\n", other_modes[i]);
+      if(!ac.getString("edit-frame-b").empty())
+	userError("option --verdict-only can not be used together with --edit-frame-b!\n");
+      quiet = true;
+      progress = false;
+   }
    int opt=0;
    // alt mode
    if(ac("error-check")) opt=1; 
+   if(ac("verdict-only")) opt=1;
    if(ac("fix-headers")) opt=1;
    if(ac("fix-crc")) opt=1;
    if(ac("add-tag")) opt=1;
@@ -1375,14 +3494,21 @@ int main(int argc, char *argv[]) {
    if(ac("list")) opt++; 
    if(ac("compact-list")) opt++; 
    if(ac("raw-list")) opt++; 
+   if(ac("read-binary-log")) opt++;
    if(ac("print-files")) opt=1;
    // check for mode
    if(opt==0) 
      userError("you must specify the mode of operation!  (try --help for more info)\n");
    if(opt>1) 
      userError("incompatible modes specified!  (try --help for more info)\n");
+   // output format
+   tstring format = ac.getString("format");
+   if(format == "ndjson")    output_format = FORMAT_NDJSON;
+   else if(format != "text") userError("unknown output format '%s' (try --help)!\n", format.c_str());
+   if((output_format != FORMAT_TEXT) && !streaming_modes_only(ac) && !ac("read-binary-log"))
+     userError("option --format only supports --error-check and --anomaly-check!\n");
    // color
-   if(!ac("color"))
+   if(!ac("color") || (output_format != FORMAT_TEXT))
      cval = cnor = cano = cerror = cfil = cok = "";
    if(ac("alt-color")) {
       cval = c_val;
@@ -1393,19 +3519,16 @@ int main(int argc, char *argv[]) {
       cok = c_ok;
    }
    tstring rawsepstr = ac.getString("raw-elem-sep");
-   char rawsep = strtol(rawsepstr.c_str(), 0, 0);
+   rawsep = strtol(rawsepstr.c_str(), 0, 0);
    if(!rawsepstr.empty()) if(!isdigit(rawsepstr[0])) rawsep = rawsepstr[0];
    tstring rawlinesepstr = ac.getString("raw-line-sep");
-   char rawlinesep = strtol(rawlinesepstr.c_str(), 0, 0);     
+   rawlinesep = strtol(rawlinesepstr.c_str(), 0, 0);     
    if(!rawlinesepstr.c_str()) if(!isdigit(rawlinesepstr[0])) rawsep = rawlinesepstr[0];
    if(ac("raw-list")) {
       quiet=true;
       progress=false;
    }
-   bool edit_frame_byte = !ac.getString("edit-frame-b").empty();
-   int efb_value = 0;
-   int efb_offset = 0;
-   int efb_frame = 0;
+   edit_frame_byte = !ac.getString("edit-frame-b").empty();
    if(edit_frame_byte) {
       tvector<tstring> a = split(ac.getString("edit-frame-b"), ",");
       if((a.size() != 3) || !a[0].toInt(efb_frame) || !a[1].toInt(efb_offset) || !a[2].toInt(efb_value))
@@ -1425,6 +3548,21 @@ int main(int argc, char *argv[]) {
    }
    single_line = ac("single-line");
    only_ascii = ac("ascii-only");
+   if((jobs > 1) && !dummy) {
+      if(ac("fix-headers")||ac("cut-junk-start")||ac("fix-crc")||ac("cut-junk-end")||ac("cut-tag-end")||edit_frame_byte)
+	userError("option --jobs does not support options which may modify a file (e.g --fix-crc)!\n");
+   }
+   if(stream && !streaming_modes_only(ac))
+     userError("option --stream only supports --error-check and --anomaly-check!\n");
+   tvector<tstring> policy = split(ac.getString("cache-policy"), ",");
+   for(size_t i = 0; i < policy.size(); i++) {
+      if(policy[i].empty())            continue;
+      else if(policy[i] == "sequential") cache_policy |= PAGES_SEQUENTIAL;
+      else if(policy[i] == "willneed")   cache_policy |= PAGES_WILLNEED;
+      else if(policy[i] == "populate")   cache_policy |= PAGES_POPULATE;
+      else if(policy[i] == "drop")       cache_policy |= PAGES_DROP;
+      else userError("unknown cache policy '%s' (try --help)!\n", policy[i].c_str());
+   }
    
    
    // check params
@@ -1449,44 +3587,34 @@ int main(int argc, char *argv[]) {
    ign_noamp = ac("ign-non-ampeg");
    ign_sync  = ac("ign-resync");
 
-   // get file list
-   tvector<tstring> filelist;
-   // from command line (perhaps recurse directories)
-   for(size_t i = 0; i < ac.numParam(); i++) {
-      if(recursive) {
-	 try {
-	    TFile f(ac.param(i));
-	    if(f.isdir()) {
-	       TSubTreeContext context(cross_filesystems);
-	       TDir d(f, context);
-	       filelist += findFilesRecursive(d);
-	       continue;
-	    }
-	 }
-	 catch(...) {}
-      } 
-      filelist.push_back(ac.param(i));
-   }     
-   // read filenames from text file
-   tstring filelistfile = ac.getString("filelist");
-   if(!filelistfile.empty()) {
-      try {
-	 filelist += loadTextFile(filelistfile.c_str());
-      }
-      catch(...) {
-	 userError("cannot open file '%s' for reading!\n", filelistfile.c_str());
-      }      
-   }
-   // filter filenames
+   // print binary logs
+   if(ac("read-binary-log")) exit(read_binary_logs(ac));
+
+   // get file list: command line (perhaps recurse directories) and
+   // filenames from text file, walked while checking
+   tvector<tstring> params;
+   for(size_t i = 0; i < ac.numParam(); i++)
+     params.push_back(ac.param(i));
+   tvector<tstring> accept, reject;
    if(!extensions.empty())
-     filelist = filterExtensions(filelist, split(extensions, ",;:"));
+     accept = split(extensions, ",;:");
    if(!reject_extensions.empty())
-     filelist = filterExtensions(filelist, split(reject_extensions, ",;:"), true);
+     reject = split(reject_extensions, ",;:");
+   FileList::Order order = FileList::GIVEN;
+   tstring sort = ac.getString("sort");
+   if(sort == "inode")       order = FileList::INODE;
+   else if(sort == "extent") order = FileList::EXTENT;
+   else if(sort == "size")   order = FileList::SIZE;
+   else if(sort != "none")   userError("unknown sort order '%s' (try --help)!\n", sort.c_str());
+   FileList filelist(params, recursive, cross_filesystems, ac.getInt("dir-threads"), ac.getString("filelist"), accept, reject, order);
 
    // print filelist
    if(ac("print-files")) {
-      for(size_t i = 0; i < filelist.size(); i++) 
-	printf("%s\n", filelist[i].c_str());
+      FileName file;
+      for(size_t i = 0; filelist.get(i, file); i++) {
+	 printf("%s\n", file.name.c_str());
+	 filelist.forget(i + 1);
+      }
       exit(0);
    }
    
@@ -1496,637 +3624,68 @@ int main(int argc, char *argv[]) {
    int num_ano=0;
    int num_tagsadded = 0;
    CRC16 crc(CRC16::CRC_16);   
+   FileName file;
    FILE *log = NULL;
    if(!ac.getString("log-file").empty()) {
       log = fopen(ac.getString("log-file").c_str(), "a");
       if(log==NULL)
 	userError("can't open logfile '%s'!\n", ac.getString("log-file").c_str());
    }
-   for(size_t i = 0; i < filelist.size(); i++) {
-      const char *name = filelist[i].c_str();
-      // ignore all files starting with ._ which are apple metafiles
-      {
-	  tstring t = name;
-	  t.extractFilename();
-	  if((t[0] == '.') && (t[1] == '_'))
-	      continue;
-      }
-       
-      // check for file
-      struct stat buf;
-      if(stat(name, &buf)) {
-	 fmes(name, "%scan't stat file (dangling symbolic link?)%s\n", cerror, cnor);
-	 continue;
-      }
-      if(S_ISDIR(buf.st_mode)) {
-	 fmes(name, "%signoring directory%s\n", cerror, cnor);
-	 continue;
-      }
-      if(!S_ISREG(buf.st_mode)) {
-	 fmes(name, "%signoring non regular file%s\n", cerror, cnor);
-	 continue;
-      }
-      off_t len = buf.st_size;
-      
-      // open file
-      int flags = O_RDONLY;
-      int prot = PROT_READ;
-      if(!dummy) {
-	 if(ac("fix-headers")||ac("cut-junk-start")||ac("fix-crc")||ac("cut-junk-end")||ac("cut-tag-end")||edit_frame_byte) {
-	    flags = O_RDWR;
-	    prot |= PROT_WRITE;
-	    if(nommap)
-		 userError("option --no-mmap does not yet support options which may modify a file (e.g --fix-crc)!\n");
-	 }
-      }
-      flags |= O_BINARY;
-      int fd = open(name, flags);
-      if(fd==-1) {
-	 perror("open");
-	 userError("can't open file '%s' for reading!\n", name);      
-      }
-       
-      // mmap or read file
-      const unsigned char *p;
-      const unsigned char *free_p = 0;
-      if(nommap) {
-	  // read file
-	  free_p = p = new unsigned char[len];
-	  if(read(fd, (void*)p, len) != len) {
-	      perror("read");
-	      userError("error while reading file '%s'!\n", name);
-	  }
-      } else {
-	  // mmap file
-	  if(len) {
-	      free_p = p = (const unsigned char *) mmap(0, len, prot, MAP_SHARED, fd, 0);
-	  } else {
-	      p = NULL;
-	  }
-	  if(p==(const unsigned char *)MAP_FAILED) {
-	      perror("mmap");
-	      userError("can't map file '%s'!\n", name);
-	  }
-      }
-
-      // edit single byte of a frame
-      if(edit_frame_byte) {
-	 if(progress) {
-	    tstring s = tstring(name).shortFilename(79);
-	    fprintf(stderr, "%-79.79s\r", s.c_str());
-	    fflush(stderr);
-	 }	 
-	 unsigned char *pp = const_cast<unsigned char *>(skip_n_frames(free_p, len, efb_frame));
-	 if(pp) {
-	    if(!dummy) pp[efb_offset] = efb_value;
-	 } else {
-	    fmes(name, "%sframe %s%d%s not found%s\n", cerror, cval, efb_frame, cerror, cnor);
-	    err++;
-	 }	 	 
-      }      
-            
-      // list
-      if(ac("list")||ac("compact-list")||ac("raw-list")) {
-	 // speed up list of very large files (like *.wav)
-	 int maxl = LIST_MAX_HEADER_SEARCH;
-	 int start = find_next_header(p, len<maxl?len:maxl, MIN_VALID);
-	 if(start<0) {
-	    if(!ign_noamp) {
-	       if(ac("raw-list")) {
-		  printf("%s%c%s%c%c", (len?"invalid_stream":"empty_stream"), rawsep, name, rawsep, rawlinesep);
-	       } else if(ac("compact-list")) {
-		  printf("%s%-25s%s%s %s%s%s\n", cerror, (len?"not an audio mpeg stream":"empty file"), cnor, (columns>=82?"  ":""), cfil, name, cnor);
-	       } else {	       
-		  fmes(name, "%s%s%s\n", cerror, (len?"not an audio mpeg stream":"empty file"), cnor);
-	       }
-	       err++;
-	    }
-	 } else {
-	    Header h = get_header(p+start);
-	    unsigned short int minbr = 0, maxbr = 0, avgbr;
-	    unsigned int l_min = (ign_bit?stream_duration(p, len, &minbr, &maxbr, &avgbr):len/(h.bitrate()/8));
-	    unsigned int l_mil = l_min%1000;
-	    l_min/=1000;
-	    unsigned int l_sec = l_min%60;
-	    l_min/=60;
-	    tstring l_str;
-	    if(l_min >= 60)
-	      l_str.sprintf("%2u:%02u", l_min/60, l_min%60);
-	    else 
-	      l_str.sprintf("   %2u", l_min);
-	    Tagv1 *tag=new Tagv1(p+len-128);
-	    unsigned short int tag_version=0;
-	    if(tag->isValid())
-	    	tag_version=tag->version();
-	    if(ac("list")) {
-	       unsigned int xwidth = 0;
-	       tstring n = single_line?tstring(name):tstring(name).shortFilename(columns-1);
-	       fmes(name, "mpeg %s%3.1f%s layer %s%d%s %s%2.1f%skHz %s%3d%skbps",
-		      h.version()==1.0?cval:cano, h.version(), cnor, 
-		      h.layer()==3?cval:cano, h.layer(), cnor, 
-		      h.samp_rate()==44.1?cval:cano, h.samp_rate(), cnor, 
-		      (h.bitrate()==128&&minbr==maxbr)?cval:cano, minbr!=maxbr?avgbr:h.bitrate(), cnor);
-	       if(ign_bit && columns>=83) {
-	          printf(" %s%s%s",
-		         minbr!=maxbr?cano:cval,minbr!=maxbr?"VBR":"CBR",cnor);
-		  xwidth+=4;
-	       } 
-	       printf(" %s%-12.12s%s %s%-7.7s%s %s%s%s %s%s%s %s%s%s %s%s:%02u.%02u%s",
-		      h.mode==Header::JOINT_STEREO?cval:cano, h.mode_str(), cnor,
-		      h.emphasis==Header::emp_NONE?cval:cano, h.emphasis_str(), cnor,
-		      h.protection_bit?cano:cval, h.protection_bit?"---":"crc", cnor, 
-		      h.original?cval:cano, h.original?"orig":"----", cnor,
-		      cval, h.copyright?"copy":"----", cnor,
-		      cval, l_str.c_str(), l_sec, l_mil/10, cnor);
-	       if(columns>=87+xwidth) {
-	         if(tag_version)
-		   printf(" id3 %s%1u.%1u%s", cval, tag_version>>8,
-		          tag_version&0xff,cnor);
-//		 xwidth+=8;
-	       }
-	       printf("\n");
-	    } else if(ac("compact-list")) {
-	       unsigned int xwidth = 0;
-	       printf("%s%c%s%s%d%s %s%2.0f%s %s%3d%s",
-		      h.version()==1.0?cval:cano, h.version()==1.0?'l':'L', cnor, 
-		      h.layer()==3?cval:cano, h.layer(), cnor, 
-		      h.samp_rate()==44.1?cval:cano, h.samp_rate(), cnor, 
-		      (h.bitrate()==128&&minbr==maxbr)?cval:cano, minbr!=maxbr?avgbr:h.bitrate(), cnor);
-	       if(ign_bit && columns>=80) {
-	          printf("%s%c%s",
-		         minbr==maxbr?cval:cano, minbr==maxbr?' ':'V', cnor);
-		  xwidth+=1;
-	       }
-	       printf(" %s%s%s %s%s%s %s%s%s%s%s%s%s%s%s",
-		      h.mode==Header::JOINT_STEREO?cval:cano, h.short_mode_str(), cnor,
-		      h.emphasis==Header::emp_NONE?cval:cano, h.short_emphasis_str(), cnor,
-		      h.protection_bit?cano:cval, h.protection_bit?"-":"C", cnor, 
-		      h.original?cval:cano, h.original?"O":"-", cnor,
-		      cval, h.copyright?"Y":"-", cnor);
-	       if(columns>=81+xwidth) {
-	         if(tag_version)
-		   printf(" %s%1u%s",cval,tag_version>>8,cnor);
-		 else
-		   printf(" %s-%s",cval,cnor);
-	         xwidth+=2;
-	       }
-	       tstring n = tstring(name).shortFilename(columns-(26+xwidth));
-	       n.replaceUnprintable(only_ascii);
-	       printf(" %s%3u:%02u%s %s%s%s\n",
-		      cval, l_min, l_sec, cnor, cfil, n.c_str(), cnor);  
-	    } else if(ac("raw-list")) {	       
-	       printf("valid_stream%c%.1f%c%d%c%.1f%c%d%c%s%c%s%c%s%c%s%c%s%c%s%c%u%c%u%c%u%c%s%c%c",
-		      rawsep,
-		      h.version(), rawsep,
-		      h.layer(), rawsep, 
-		      h.samp_rate(), rawsep,
-		      minbr!=maxbr?avgbr:h.bitrate(), rawsep,
-		      ign_bit?(minbr!=maxbr?"VBR":"CBR"):"?", rawsep,
-		      h.mode_str(), rawsep,
-		      h.emphasis_str(), rawsep,
-		      h.protection_bit?"---":"crc", rawsep,
-		      h.original?"orig":"copy", rawsep,
-		      h.copyright?"cprgt":"-----", rawsep,
-		      l_min, rawsep, 
-		      l_sec, rawsep, 
-		      l_mil, rawsep,
-		      name, rawsep, rawlinesep);
-	    }
-	    delete tag;
-	 }
-      }
-      
-      // cut-junk-start
-      if(ac("cut-junk-start")) {
-	 int start = find_next_header(p, len, MIN_VALID);
-	 if(start<0) {
-	    fmes(name, "%s%s%s\n", cerror, (len?"not an audio mpeg stream":"empty file"), cnor);
-	    err++;
-	 } else if(start==0) {
-	    fmes(name, "%scut-junk-start: no junk found%s\n", cok, cnor);	    
-	 } else {
-	    fmes(name, "%scut-junk-start: removing first %s%d%s byte%s, %sretrying%s\n",
-		 cok, cval, start, cok, (start>1)?"s":"", dummy?"not (due to dummy) ":"", cnor);
-	    if(!dummy) {
-	       // move start to begining and truncate the file
-	       memmove((char*)free_p, free_p + start, len - start);
-	       if(munmap((char*)free_p, len)) {
-		  perror("munmap");
-		  userError("can't unmap file '%s'!\n", name);
-	       }
-	       len-=start;
-#ifndef __STRICT_ANSI__
-	       if(ftruncate(fd, len) < 0) {
-		  perror("ftruncate");
-	       }
-#else
-	       userError("cannot truncate file since this executable was compiled with __STRICT_ANSI__ defined!\n");
-#endif
-	       close(fd);      
-	       
-	       // retry this file 
-	       --i;
-	       continue;
-	    }
-	 }
-      }
-
-      // cut-tag-end
-      if(ac("cut-tag-end")) {
-	 // lots of side effects: perhaps unmaps and closes file
-	 if(cut_tag_end(name, p, len, fd, err)) {
-	    // retry this file if not dummy
-	    if(!dummy) {
-	       --i;
-	       continue;
-	    }
-	 }
-      }
-
-      // cut-junk-end
-      if(ac("cut-junk-end")) {
-	 // lots of side effects: perhaps unmaps and closes file
-	 if(cut_junk_end(name, p, len, free_p, fd, err)) {
-	    // retry this file if not dummy
-	    if(!dummy) {
-	       --i;
-	       continue;	   
-	    }	   
-	 }
-      }
-      
-      // check for errors
-      if(ac("error-check") || ac("fix-headers") || ac("fix-crc")) {
-	 if(progress) {
-	    tstring s = tstring(name).shortFilename(79);
-	    fprintf(stderr, "%-79.79s\r", s.c_str());
-	    fflush(stderr);
-	 }
-	 if(error_check(name, p, len, crc, ac("fix-headers"), ac("fix-crc"))) {
-	    if(log) fprintf(log, "%s\n", name);
-	    ++err;
-	 }
-      }
-
-      // check for anomalies
-      if(ac("anomaly-check")) {
-	 if(progress) {
-	    tstring s = tstring(name).shortFilename(79);
-	    fprintf(stderr, "%-79.79s\r", s.c_str());
-	    fflush(stderr);
-	 }
-	 if(anomaly_check(name, p, len, ac("error-check"), err)) ++num_ano;
-      }      
-            
-      // dump header
-      if(ac("dump-header")) {
-	 fmes(name, "\n");
-	 for(int k=0; k<len-3; p++, k++) {
-	    if(*p==255) {
-	       Header h;	       
-	       h = get_header(p);
-	       if(h.syncword==0xfff) {
-		  tstring s=h.print();
-		  printf("%7d %s\n", k, s.c_str());
-		  int l = frame_length(h);
-		  if(l>=21) {
-		     p+=l;
-		     p--;
-		     k+=l;
-		     k--;
-		  }
-	       }
-	    }
-	 }
-      }      
-      
-      // dump tag
-      if(ac("dump-tag")) {
-         unsigned int err_thisfile=0;
-	 fmes(name, "\n");
-	 Tagv1 *tag=new Tagv1;
-	 for(int k=0; k<len-127; k++) {
-      	    tag->setTarget(p+k);
-	    if(tag->isValidGuess()) {
-	       printf("  Found at: %s0x%08x%s (%s%s%s)\n", cval, k, cnor,
-	              (k==len-128?cok:cerror),
-		      ((k==len-128)||!(++err_thisfile)?"end":"in the stream"), cnor);
-	       tag->fillFields();
-	       printf("  Version: %s%u.%u%s\n", cval, tag->fields_version>>8,
-	              tag->fields_version&0xff, cnor);
-	       printf("  Conforms to specification: %s%s%s\n",
-	              (tag->isValidSpecs()&&!tag->fields_spacefilled?cok:cerror),
-	              (tag->isValidSpecs()||!(++err_thisfile)?(tag->fields_spacefilled?"space filled":"yes"):"no"),
-		      cnor);
-	       printf("  Title: \"%s%s%s\"\n", cval, tag->field_title, cnor);
-	       printf("  Artist: \"%s%s%s\"\n", cval, tag->field_artist, cnor);
-	       printf("  Album: \"%s%s%s\"\n", cval, tag->field_album, cnor);
-	       printf("  Year: \"%s%s%s\"\n", cval, tag->field_year, cnor);
-	       printf("  Comment: \"%s%s%s\"\n", cval, tag->field_comment, cnor);
-	       if(tag->field_genre==0xff) // not set
-	          printf("  Genre: not set\n");
-	       else
-	       {
-	          printf("  Genre: %s%s%s\n", ((tag->field_genre>=Tagv1::genres_count)?cerror:cval),
-		         ((tag->field_genre<Tagv1::genres_count)?(Tagv1::id3_genres[tag->field_genre]):"unknown"),
-			 cnor);
-	       }
-	       if(tag->field_track)
-	          printf("  Track: %s%u%s\n", cval, tag->field_track, cnor);
-	       k+=2;
-	    }
-      	 }
-	 delete tag;
-         if(err_thisfile) ++err;
-      }
-       
-       // --add-id3
-       bool addTag = false;
-       if(ac("add-tag"))
-       {
-	   if(progress) {
-	       tstring s = tstring(name).shortFilename(79);
-	       fprintf(stderr, "%-79.79s\r", s.c_str());
-	       fflush(stderr);
-	   }
-	   // check for existing tag
-	   if(checkForID3V1(p, len))
-	   {
-	       if(ac("verbose"))
-		   fmes(name, "id3 tag v1.x found, not adding anything\n");
-	   }
-	   else if(checkForID3V2(p, len))
-	   {
-	       if(ac("verbose"))
-		   fmes(name, "id3 tag v2.x found, not adding anything\n");
-	   }
-#if 0	   
-	   // this wqs just here to make sure we do not mis something
-	   else if(checkForTagsSloppy(p, len))
-	   {
-	       fmes(name, "some tag found\n");	       
-	   }
-#endif	   
-	   else
-	   {
-	       // no tag found: add tag
-	       addTag = true;
-	   }
-       }
-      
-      if(nommap) {
-	  // free mem
-	  delete[] free_p;
-      } else {
-	  // unmap file and close
-	  if((free_p!=NULL)&&munmap((char*)free_p, len)) {
-	      perror("munmap");
-	      userError("can't unmap file '%s'!\n", name);
-	  }
+   if(!ac.getString("cache").empty()) {
+      if(!streaming_modes_only(ac))
+	userError("option --cache only supports --error-check and --anomaly-check!\n");
+      cache = new ResultCache(ac.getString("cache"), cache_signature(ac));
+   }
+   if(!ac.getString("binary-log").empty()) {
+      if(!streaming_modes_only(ac))
+	userError("option --binary-log only supports --error-check and --anomaly-check!\n");
+      if(cache)
+	userError("option --binary-log can not be used together with --cache!\n");
+      if(verdict_only)
+	userError("option --binary-log can not be used together with --verdict-only!\n");
+      binary_log = new BinaryLog(ac.getString("binary-log"));
+   }
+   if(ac.getInt("read-ahead")) {
+      if(!streaming_modes_only(ac))
+	userError("option --read-ahead only supports --error-check and --anomaly-check!\n");
+      read_ahead = new ReadAhead(filelist, ac.getInt("read-ahead"), cache_policy & PAGES_DROP);
+   }
+   if(jobs > 1) {
+      // progress is shown per file by the writer
+      bool show_progress = progress;
+      progress = false;
+      check_parallel(ac, filelist, jobs, show_progress, log, err, checked, num_ano, num_tagsadded);
+   } else for(size_t i = 0; filelist.get(i, file); i++) {
+      FileResult res;
+      int r;
+      while((r = check_file(ac, file, i, crc, res)) == FILE_RETRY) {
+	 // the file has been modified, check it again
+	 file.stated = false;
+	 res = FileResult();
       }
-       // close file
-      close(fd);       
-       
-       // add tag? (see above)
-       if(addTag)
-       {	   
-	   // extract data from filename
-	   tstring title;  // 30
-	   tstring artist; // 30
-	   tstring album;  // 30
-	   tstring comment;// 28
-	   char track = 0;     // 1
-	   tstring fname = name;
-	   fname.translateChar('_', ' ');
-	   fname.searchReplace("cd 1", "cd1");
-	   fname.searchReplace("cd 2", "cd2");
-	   fname.searchReplace("cd 3", "cd3");
-	   fname.searchReplace("cd 4", "cd4");
-	   fname.searchReplace(" - ms/disc1/", "/cd1 - ");
-	   fname.searchReplace(" - ms/disc2/", "/cd2 - ");
-	   fname.searchReplace("/cd1/", " - cd1/");
-	   fname.searchReplace("/cd2/", " - cd2/");
-	   fname.searchReplace("/cd3/", " - cd3/");
-	   fname.searchReplace("/cd4/", " - cd4/");
-	   fname.searchReplace("zance - a decade of dance from ztt", "zance decade of dance from ztt");
-	   fname.searchReplace("/captain future soundtrack - ", "/");
-	   fname.searchReplace("-ms/", "/");
-	   fname.collapseSpace();
-	   title = fname;
-	   album = fname;
-	   comment = fname;
-	   title.extractFilename();
-	   album.extractPath();
-	   album.removeDirSlash();
-	   album.extractFilename();
-	   comment.extractPath();
-	   comment.removeDirSlash();
-	   comment.extractPath();
-	   comment.removeDirSlash();
-	   comment.extractFilename();
-
-	   // title
-	   // remove album
-	   if(title != album)
-	       title.searchReplace(album, "");
-	   // remove .mp3
-	   if((title.length() >= 4) && strcasecmp(title.c_str() + title.length(), ".mp3"))
-	       title.truncate(title.length() - 4);
-	   // check for cd1 - 
-	   if((strcasecmp(title.substr(0, 3).c_str(), "CD1") == 0) ||
-	      (strcasecmp(title.substr(0, 3).c_str(), "CD1") == 0) ||
-	      (strcasecmp(title.substr(0, 3).c_str(), "CD2") == 0))
-	   {
-	       album += " " + title.substr(0,3);
-	       title = title.substr(3);
-	       // skip separator
-	       while(strchr(" -.", title.c_str()[0])) 
-		   title = title.substr(1);
-	   }
-	   // check for AA-TT format
-	   if(isdigit(title[0]) && isdigit(title[1]) && isdigit(title[3]) && isdigit(title[4]) && (title[2] == '-'))
-	   {
-	       album += " cd" + title.substr(1,2);
-	       title = title.substr(3);
-	   }
-	   // check for 'audio '
-	   tstring ltitle = title;
-	   ltitle.lower();
- 	   if(ltitle.substr(0, 5) == "audio")
-	       title = title.substr(5) + " " + title.substr(0, 5);
- 	   else if(ltitle.substr(0, 10) == "track cd -")
-	   {
-	       title = title.substr(10);
-	       album += " track cd";
-	   }
- 	   else if(ltitle.substr(0, 8) == "mix cd -")
-	   {
-	       title = title.substr(8);
-	       album += " mix cd";
-	   }
- 	   else if(ltitle.substr(0, 6) == "track-")
-	       title = title.substr(6) + " " + title.substr(0, 6);
- 	   else if(ltitle.substr(0, 5) == "track")
-	       title = title.substr(5) + " " + title.substr(0, 5);
-	   title.cropSpace();
-	   title.collapseSpace();
-	   
-	   // scan track
-	   size_t pos = 0;
-	   while(isdigit(title.c_str()[pos])) pos++;
-	   if((pos >= 1) && (pos <=2))
-	   {
-	       int t = 0;
-	       title.substr(0, pos).toInt(t, 10);
-	       track = t;	       
-	   }
-	   else if(pos > 2)
-	       pos = 0;
-	   // skip separator
-	   while(strchr(" -.", title.c_str()[pos])) pos++;
-	   title = title.substr(pos);
-	   // split artist - title
-	   splitArtistTitle(title, artist, title);
-	   title.cropSpace();
-
-	   // album
-	   tstring ar;
-	   // split artist - album
-	   if((album == "alben") ||
-	      (album == "cdrom2") ||
-	      (album == "cdrom") ||
-	      (album == "misc1") ||
-	      (album == "mp3") ||
-	      (album == "ov") ||
-	      (album == "all"))
-	       album = "";
-	   splitArtistTitle(album, ar, album);
-	   if((!artist.empty()) && (!ar.empty()))
-	   {
-	       if(artist != ar)
-	       {
-		   title = artist + "-" + title;
-		   artist = ar;
-	       }
-	   }
-	   else if(artist.empty())
-	   {
-	       artist = ar;
-	       ar = "";
-	   }
-	   if(artist.empty())
-	   {
-	       artist = album;
-	       album = "";
-	   }
-	   album.cropSpace();
-	   artist.cropSpace();
-	   if(artist == "diverse")
-	       artist = "";
-	   
-	   // comment
-	   comment.cropSpace();
-	   if((comment == "alben") ||
-	      (comment == "cdrom2") ||
-	      (comment == "cdrom") ||
-	      (comment == "mp3") ||
-	      (comment == "ov") ||
-	      (comment == "chr music") ||
-	      (comment == "mp3 dl") ||
-	      (comment == "diverse") ||
-	      (comment.substr(0, 2) == "M0") ||
-	      (comment.substr(0, 7) == "Unknown") ||
-	      (comment.substr(0, 7) == "Various") ||
-	      (comment == "all"))
-	       comment = "";
-
-	   // capitalize strings
-	   capitalize(title);
-	   capitalize(artist);
-	   capitalize(album);
-	   capitalize(comment);
-	   
-	   // move rest of long strings into comment
-	   if(title.length() > 30)
-	       title.searchReplace(" - ", "-");
-	   if(artist.length() > 30)
-	       artist.searchReplace(" - ", "-");
-	   if(album.length() > 30)
-	       album.searchReplace(" - ", "-");
-	   if(title.length() > 30)
-	   {
-	       comment = "T:" + title.substr(30);
-	       title.truncate(30);
-	   }
-	   if(artist.length() > 30)
-	   {
-	       comment = "R:" + artist.substr(30);
-	       artist.truncate(30);
-	   }
-	   if(album.length() > 30)
-	   {
-	       comment = "L:" + album.substr(30);
-	       album.truncate(30);
-	   }
-
-	   // print and check tag
-//	   fmes(name, "appending id3 tag v1.1:\ntitle=  '%s%s%s'\nartist= '%s%s%s'\nalbum=  '%s%s%s'\ncomment='%s%s%s'\ntrack=  %s%d%s\n", 
-//		cval, title.c_str(), cnor, cval, artist.c_str(), cnor, cval, album.c_str(), cnor, cval, comment.c_str(), cnor, cval, track, cnor);
-	   fmes(name, "'%s%-30.30s%s' '%s%-30.30s%s' '%s%-30.30s%s' '%s%-28.28s%s' %s%d%s\n",
-		cval, title.c_str(), cnor, cval, artist.c_str(), cnor, cval, album.c_str(), cnor, cval, comment.c_str(), cnor, cval, track, cnor);
-	   if(title.length() > 30)
-	       printf("%swarning%s: title > 30 chars\n", cerror, cnor);
-	   if(artist.length() > 30)
-	       printf("%swarning%s: artist > 30 chars\n", cerror, cnor);
-	   if(album.length() > 30)
-	       printf("%swarning%s: album > 30 chars\n", cerror, cnor);
-	   if(comment.length() > 28)
-	       printf("%swarning%s: comment > 28\n", cerror, cnor);
-	   if(track == 0)
-	       printf("%swarning%s: no track\n", cerror, cnor);
-	   
-	   // write tag
-	   char tag[128];
-	   memset(tag, 0, 128);
-	   tag[0] = 'T';
-	   tag[1] = 'A';
-	   tag[2] = 'G';
-	   strncpy(tag + 3, title.c_str(), 30);
-	   strncpy(tag + 3 + 30, artist.c_str(), 30);
-	   strncpy(tag + 3 + 60, album.c_str(), 30);
-	   strncpy(tag + 3 + 90 + 4, comment.c_str(), 28);
-	   tag[126] = track;
-	   tag[127] = -1;
-	   num_tagsadded++;
-#if 1
-	   if(!dummy)
-	   {
-	       // append to file
-	       FILE *f = fopen(name, "ab");
-	       if(f == 0)
-		   userError("can't open file '%s' for writing!\n", name);
-	       if(fwrite(tag, 1, 128, f) != 128)
-		   userError("error while writing to file '%s'\n", name);
-	       fclose(f);
-	   }
-#endif
-       }
-       
-      ++checked;
+      if(read_ahead) read_ahead->release(i);
+      err += res.err;
+      if(res.ano) ++num_ano;
+      if(res.tagadded) ++num_tagsadded;
+      if(res.log && log) fprintf(log, "%s\n", file.name.c_str());
+      if(r == FILE_CHECKED) ++checked;
+      filelist.forget(i + 1);
+      flush_stdout_output();
+      // the exit status is known
+      if(verdict_only && (err || num_ano)) break;
    } // for all params
+   if(cache) {
+      // only the walked directories tell which files are gone
+      if(recursive) cache->prune(params);
+      cache->save();
+      delete cache;
+   }
+   delete binary_log;
+   delete read_ahead;
 
    // print final statistics
-   if((filelist.size()>1)&&(!ac("raw-list")) && (!ac("no-summary")) && (!quiet)) {
-      printf("--                                                                             \n"
-	     "%s%d%s file%s %s, %s%d%s erroneous file%s found\n", 
-	     cval, checked, cnor, checked==1?"":"s", 
-	     ac("list")?"listed":"checked", cval, err, cnor, err==1?"":"s");
-      if(num_ano) printf("(%s%d%s %sanomal%s%s found)\n", 
-			 cval, num_ano, cnor, cano, num_ano==1?"y":"ies", cnor);
-       if(num_tagsadded)
-	   printf("(%s%d%s tags added)\n", 
-		  cval, num_tagsadded, cnor);
-   }
+   if((filelist.count()>1)&&(!ac("raw-list")) && (!ac("no-summary")) && (!quiet))
+     print_totals(ac, checked, err, num_ano, num_tagsadded);
    
    // end
    if(log!=NULL) fclose(log);
@@ -0,0 +1,70 @@
+/*GPL*START*
+ *
+ * page cache hints
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "pagecache.h"
+
+
+PageResidency::PageResidency(int fd, off_t len_): len(len_), pagesize(sysconf(_SC_PAGESIZE)), resident(0) {
+#ifdef __linux__
+   if(len == 0) return;
+   // mapping the file does not read it
+   void *m = mmap(0, len, PROT_READ, MAP_SHARED, fd, 0);
+   if(m == MAP_FAILED) return;
+   resident = new unsigned char[(len + pagesize - 1) / pagesize];
+   if(mincore(m, len, resident)) {
+      delete[] resident;
+      resident = 0;
+   }
+   munmap(m, len);
+#else
+   (void)fd;
+#endif
+}
+
+
+PageResidency::~PageResidency() {
+   delete[] resident;
+}
+
+
+void PageResidency::drop(int fd) const {
+#ifdef __linux__
+   if(resident == 0) return;
+   off_t n = (len + pagesize - 1) / pagesize;
+   for(off_t i = 0; i < n; ) {
+      if(resident[i] & 1) {
+	 i++;
+	 continue;
+      }
+      // drop the run of pages which were not resident
+      off_t j = i;
+      while((j < n) && !(resident[j] & 1)) j++;
+      posix_fadvise(fd, i * pagesize, (j - i) * pagesize, POSIX_FADV_DONTNEED);
+      i = j;
+   }
+#else
+   (void)fd;
+#endif
+}
@@ -0,0 +1,57 @@
+/*GPL*START*
+ *
+ * page cache hints header file
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#ifndef _pagecache_h_
+#define _pagecache_h_
+
+#include <sys/types.h>
+
+// 2026:
+// 16 Oct  started
+
+
+// pages of a file which are in the page cache before the file is read,
+// so afterwards only the pages brought in by reading it are dropped
+// again and the working set of other programs on the host stays cached
+// (does nothing on systems without mincore() and posix_fadvise())
+class PageResidency {
+ public:
+   // remember the resident pages of file fd of length len
+   PageResidency(int fd, off_t len);
+   ~PageResidency();
+   
+   // drop all pages of file fd which were not resident at construction
+   // (the file must not be mapped any more)
+   void drop(int fd) const;
+   
+ private:
+   // forbid copy
+   PageResidency(const PageResidency&);
+   const PageResidency& operator=(const PageResidency&);
+   
+   off_t len;
+   off_t pagesize;
+   unsigned char *resident;  // one byte per page, bit 0 set if the page was resident, 0 == unknown
+};
+
+
+#endif
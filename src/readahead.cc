@@ -0,0 +1,180 @@
+/*GPL*START*
+ *
+ * reading files ahead of the check
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include "readahead.h"
+#include "pagecache.h"
+#include "tappconfig.h"
+
+// default value for systems which do not define O_BINARY
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+
+ReadAhead::ReadAhead(FileList& list_, int n, bool drop_):
+list(list_), ring(n), low(0), next(0), drop(drop_), end(false), quit(false), threads(n) {
+   pthread_mutex_init(&mutex, 0);
+   pthread_cond_init(&cond, 0);
+   for(int i = 0; i < n; i++)
+      if(pthread_create(&threads[i], 0, thread, this))
+	userError("can't create read ahead thread!\n");
+}
+
+
+ReadAhead::~ReadAhead() {
+   pthread_mutex_lock(&mutex);
+   quit = true;
+   pthread_cond_broadcast(&cond);
+   pthread_mutex_unlock(&mutex);
+   for(size_t i = 0; i < threads.size(); i++)
+      pthread_join(threads[i], 0);
+   for(size_t i = 0; i < ring.size(); i++)
+      delete[] ring[i].data;
+   pthread_cond_destroy(&cond);
+   pthread_mutex_destroy(&mutex);
+}
+
+
+bool ReadAhead::take(const char *name, const struct stat& st, unsigned char *& data) {
+   bool r = false;
+   pthread_mutex_lock(&mutex);
+   for(size_t i = low; i < next; i++) {
+      Entry& e = ring[i % ring.size()];
+      if((e.index != i) || (e.state == TAKEN) || released[i - low] || (e.file.name != name)) continue;
+      while(e.state == READING)
+	 pthread_cond_wait(&cond, &mutex);
+      if((e.state == DONE) && (e.st.st_dev == st.st_dev) && (e.st.st_ino == st.st_ino) &&
+	 (e.st.st_size == st.st_size) && (e.st.st_mtime == st.st_mtime)) {
+	 data = e.data;
+	 r = true;
+      } else {
+	 delete[] e.data;
+      }
+      e.data = 0;
+      e.state = TAKEN;
+      break;
+   }
+   pthread_mutex_unlock(&mutex);
+   return r;
+}
+
+
+void ReadAhead::release(size_t i) {
+   pthread_mutex_lock(&mutex);
+   released[i - low] = true;
+   Entry& e = ring[i % ring.size()];
+   if((e.index == i) && (i >= low) && (i < next)) {
+      // wait for a file which is still being read, its entry is reused
+      while(e.state == READING)
+	 pthread_cond_wait(&cond, &mutex);
+      delete[] e.data;
+      e.data = 0;
+   }
+   while(released.size() && released[0]) {
+      released.erase(released.begin());
+      low++;
+   }
+   // files which are done need not be read (the check overtook the read ahead)
+   if(next < low) next = low;
+   pthread_cond_broadcast(&cond);
+   pthread_mutex_unlock(&mutex);
+}
+
+
+void *ReadAhead::thread(void *arg) {
+   ReadAhead& ra = *(ReadAhead *)arg;
+   pthread_mutex_lock(&ra.mutex);
+   for(;;) {
+      while(!ra.quit && !ra.end && (ra.next >= ra.low + ra.ring.size()))
+	 pthread_cond_wait(&ra.cond, &ra.mutex);
+      if(ra.quit || ra.end) break;
+      size_t i = ra.next++;
+      if(ra.released[i - ra.low]) continue;
+      // reserve the entry, release(i) waits for it (so the list can not 
+      // forget file i before it is got)
+      Entry& e = ra.ring[i % ra.ring.size()];
+      e.index = i;
+      e.file = FileName();
+      e.state = READING;
+      e.data = 0;
+      pthread_mutex_unlock(&ra.mutex);
+      // without lock: the list may walk directories or sort a batch first
+      FileName file;
+      bool ok = ra.list.get(i, file);
+      pthread_mutex_lock(&ra.mutex);
+      if(!ok) {
+	 // end of the list
+	 e.state = FAILED;
+	 ra.end = true;
+	 pthread_cond_broadcast(&ra.cond);
+	 break;
+      }
+      e.file = file;
+      pthread_mutex_unlock(&ra.mutex);
+      ra.read(e);
+      pthread_mutex_lock(&ra.mutex);
+      pthread_cond_broadcast(&ra.cond);
+   }
+   pthread_mutex_unlock(&ra.mutex);
+   return 0;
+}
+
+
+void ReadAhead::read(Entry& e) {
+   const char *name = e.file.name.c_str();
+   unsigned char *data = 0;
+   struct stat st;
+   
+   // stat first (unless the walk did): opening a named pipe would block
+   if(e.file.stated) st = e.file.st;
+   bool ok = (strcmp(name, "-") != 0) && (e.file.stated || (stat(name, &st) == 0)) && S_ISREG(st.st_mode) && (st.st_size <= MAX_SIZE);
+   int fd = ok ? open(name, O_RDONLY | O_BINARY) : -1;
+   ok = (fd != -1) && (fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size <= MAX_SIZE);
+   if(ok) {
+      PageResidency *residency = drop ? new PageResidency(fd, st.st_size) : 0;
+      data = new unsigned char[st.st_size];
+      for(off_t done = 0; ok && (done < st.st_size); ) {
+	 ssize_t n = pread(fd, data + done, st.st_size - done, done);
+	 if(n <= 0) ok = false;
+	 else done += n;
+      }
+      if(residency) {
+	 residency->drop(fd);
+	 delete residency;
+      }
+   }
+   if(fd != -1) close(fd);
+   
+   pthread_mutex_lock(&mutex);
+   if(ok) {
+      e.data = data;
+      e.st = st;
+      e.state = DONE;
+   } else {
+      delete[] data;
+      e.state = FAILED;
+   }
+   pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,96 @@
+/*GPL*START*
+ *
+ * reading files ahead of the check header file
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#ifndef _readahead_h_
+#define _readahead_h_
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "tstring.h"
+#include "tvector.h"
+#include "filelist.h"
+
+// 2026:
+// 16 Oct  started
+// 16 Oct  drop the pages read from the page cache again
+// 16 Oct  read from a FileList, use the status of the files known from the walk
+// 16 Oct  get the files from the list without lock
+
+
+// read the files of a file list into memory ahead of the check, with one
+// thread per file in flight, so slow devices (cold disks, network file
+// systems) always have several requests queued instead of only the one of
+// the file just checked
+// files are read at most n files ahead of the oldest file not yet released
+class ReadAhead {
+ public:
+   // larger files are not read ahead
+   enum {MAX_SIZE = 64*1024*1024};
+   
+   // start n threads reading the files of list
+   // drop: remove the pages brought into the page cache by reading a file again
+   ReadAhead(FileList& list, int n, bool drop);
+   ~ReadAhead();
+   
+   // return true and the data (allocated with new[]) if file name with 
+   // status st has been read ahead, waits if the file is just being read
+   // returns false if it has not been read (or has changed since)
+   bool take(const char *name, const struct stat& st, unsigned char *& data);
+   // file i of the list is done: free its data if it was not taken and
+   // read further ahead
+   void release(size_t i);
+   
+ private:
+   // forbid copy
+   ReadAhead(const ReadAhead&);
+   const ReadAhead& operator=(const ReadAhead&);
+   
+   enum State {READING, DONE, FAILED, TAKEN};
+   struct Entry {
+      Entry(): index(~(size_t)0), state(FAILED), data(0) {}
+      size_t index;         // index of the file in the list
+      FileName file;
+      State state;
+      unsigned char *data;  // contents of the file if DONE
+      struct stat st;       // status of the file when it was read
+   };
+   
+   static void *thread(void *arg);
+   // read the file of e into e (called without lock)
+   void read(Entry& e);
+   
+   FileList& list;
+   tvector<Entry> ring;     // entry of file i is ring[i % ring.size()] for low <= i < next
+   tvector<char> released;  // release() was called for file low + i
+   size_t low;              // oldest file not yet released
+   size_t next;             // next file to read
+   bool drop;
+   bool end;                // the end of the list has been reached
+   bool quit;
+   tvector<pthread_t> threads;
+   pthread_mutex_t mutex;   // protects all of the above
+   pthread_cond_t cond;     // signalled whenever a file is read or released
+};
+
+
+#endif
@@ -0,0 +1,113 @@
+/*GPL*START*
+ *
+ * structured messages of the error and anomaly check
+ *
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/
+
+#include <stdio.h>
+#include "report.h"
+
+// names of the event types, the order of Event::Type
+static const char *type_names[Event::NUM_TYPES] = {
+   "not_mpeg",
+   "empty_file",
+   "junk_start",
+   "tag_in_junk_start",
+   "tag_trailer",
+   "sync_short",
+   "sync_long",
+   "fix_sync",
+   "constant_switch",
+   "fix_header",
+   "bitrate_switch",
+   "crc_error",
+   "max_errors",
+   "truncated",
+   "junk_end",
+   "tag_in_junk_end",
+   "valid",
+   "anomaly_version",
+   "anomaly_layer",
+   "anomaly_sampling",
+   "anomaly_bitrate",
+   "anomaly_mode",
+   "anomaly_crc",
+   "anomaly_emphasis"
+};
+
+
+const char *Event::name(int type) {
+   if((type < 0) || (type >= NUM_TYPES)) return "unknown";
+   return type_names[type];
+}
+
+
+// length of the valid utf-8 sequence at s (1 to 4), 0 if it is invalid
+static int utf8_length(const unsigned char *s) {
+   unsigned char c = s[0];
+   int n;
+   unsigned int min;
+   unsigned int v;
+   if(c < 0x80) return 1;
+   else if((c & 0xe0) == 0xc0) {n = 2; min = 0x80;    v = c & 0x1f;}
+   else if((c & 0xf0) == 0xe0) {n = 3; min = 0x800;   v = c & 0x0f;}
+   else if((c & 0xf8) == 0xf0) {n = 4; min = 0x10000; v = c & 0x07;}
+   else return 0;
+   for(int i = 1; i < n; i++) {
+      if((s[i] & 0xc0) != 0x80) return 0; // also stops at the terminating 0
+      v = (v << 6) | (s[i] & 0x3f);
+   }
+   // overlong, surrogate or beyond unicode
+   if((v < min) || ((v >= 0xd800) && (v <= 0xdfff)) || (v > 0x10ffff)) return 0;
+   return n;
+}
+
+
+tstring json_string(const char *s) {
+   tstring r("\"");
+   while(*s) {
+      unsigned char c = *s;
+      int n = utf8_length((const unsigned char *)s);
+      if(n > 1) {
+	 r.append(s, n);
+	 s += n;
+	 continue;
+      }
+      s++;
+      switch(c) {
+       case '"':  r += "\\\""; break;
+       case '\\': r += "\\\\"; break;
+       case '\n': r += "\\n"; break;
+       case '\r': r += "\\r"; break;
+       case '\t': r += "\\t"; break;
+       default:
+	 if((c < 0x20) || (n == 0)) {
+	    // control chars and bytes which are not valid utf-8 (e.g. latin-1
+	    // file names): the code point of the byte
+	    char buf[8];
+	    snprintf(buf, sizeof(buf), "\\u%04x", c);
+	    r += buf;
+	 } else {
+	    r += (char)c;
+	 }
+      }
+   }
+   r += "\"";
+   return r;
+}
@@ -0,0 +1,108 @@
+/*GPL*START*
+ *
+ * structured messages of the error and anomaly check header file
+ *
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/
+
+#ifndef _report_h_
+#define _report_h_
+
+#include <sys/types.h>
+#include "tstring.h"
+
+// 2026:
+// 16 Oct  started: events of -e and -a, formatted as text or as ndjson
+
+
+// every message of the error and anomaly check is an event: the checks
+// only fill in the values, the output format decides how it is printed
+// (the meaning of count, expected and actual depends on the type)
+struct Event {
+   enum Type {
+      NOT_MPEG,           // count: file size
+      EMPTY_FILE,
+      JUNK_START,         // count: bytes of junk before the first frame
+      TAG_IN_JUNK_START,  // offset of the tag, actual: tag version, flag: valid tag
+      TAG_TRAILER,        // offset of the tag, count: number of the tag from the end, actual: tag version, flag: valid tag
+      SYNC_SHORT,         // offset of the frame, expected: frame length, actual: distance to the next frame
+      SYNC_LONG,          // offset of the frame, expected: frame length, actual: distance to the next frame
+      FIX_SYNC,           // offset of the new header
+      CONSTANT_SWITCH,    // offset of the frame, expected: previous header, actual: header
+      FIX_HEADER,         // offset of the frame
+      BITRATE_SWITCH,     // offset of the frame, expected: previous bitrate, actual: bitrate
+      CRC_ERROR,          // offset of the frame, expected: calculated crc, actual: crc of the frame, flag: fixed
+      MAX_ERRORS,
+      TRUNCATED,          // count: bytes missing for the last frame
+      JUNK_END,           // offset and count: bytes of junk after the last frame
+      TAG_IN_JUNK_END,    // offset of the tag, actual: tag version, flag: valid tag
+      VALID,
+      ANOMALY_VERSION,    // actual: header of the first frame (for all anomalies)
+      ANOMALY_LAYER,
+      ANOMALY_SAMPLING,
+      ANOMALY_BITRATE,
+      ANOMALY_MODE,
+      ANOMALY_CRC,
+      ANOMALY_EMPHASIS,
+      NUM_TYPES
+   };
+
+   Event(int type_ = NOT_MPEG): type(type_), frame(-1), time(0.0), offset(-1),
+   count(0), expected(0), actual(0), flag(false) {}
+
+   int type;
+   int frame;           // number of the frame (-1 == not about a frame)
+   double time;         // start time of the frame in ms
+   off_t offset;        // position in the file (-1 == none)
+   long long count;     // number of bytes
+   long long expected;
+   long long actual;
+   bool flag;
+
+   // name of the type in structured output
+   static const char *name(int type);
+   // true for anomalies, false for errors and VALID
+   static bool isAnomaly(int type) {return type >= ANOMALY_VERSION;}
+};
+
+
+// summary of the check of one file
+struct CheckSummary {
+   CheckSummary(): error(false), anomaly(false), frames(-1), time(0.0), errors(0), anomalies(0),
+   header(0), min_bitrate(0), max_bitrate(0), avg_bitrate(0), vbr(false) {}
+   bool error;         // erroneous file
+   bool anomaly;       // anomaly found
+   int frames;         // number of frames (-1 == not checked for errors)
+   double time;        // duration in ms
+   int errors;         // number of errors
+   int anomalies;      // number of anomalies
+   unsigned int header;// header of the first frame (0 == none)
+   int min_bitrate;    // bitrates in kbit/s (0 == unknown)
+   int max_bitrate;
+   int avg_bitrate;
+   bool vbr;
+};
+
+
+// return s as a quoted json string: valid utf-8 is kept, every byte which
+// is not part of valid utf-8 (e.g. latin-1 file names) is escaped as \u00XX,
+// the character of its latin-1 code, so the record stays valid json
+tstring json_string(const char *s);
+
+
+#endif
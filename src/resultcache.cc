@@ -0,0 +1,251 @@
+/*GPL*START*
+ *
+ * cache of check results
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "resultcache.h"
+#include "tappconfig.h"
+
+// file format: the magic line, the signature line and one record per file:
+// device, inode, size, mtime, mtime ns, ctime, ctime ns (64 bit each), err
+// (32 bit), flags (32 bit: bit 0 ano, bit 1 log), name and text (32 bit
+// length and bytes), all in host byte order (the cache is local to one machine)
+static const char *MAGIC = "mp3check result cache 2\n";
+
+
+// nanoseconds of the times of a file, 0 where unknown
+#if defined(__APPLE__)
+static long mtime_nsec(const struct stat& st) {return st.st_mtimespec.tv_nsec;}
+static long ctime_nsec(const struct stat& st) {return st.st_ctimespec.tv_nsec;}
+#elif defined(st_mtime) // POSIX.1-2008: st_mtime is st_mtim.tv_sec
+static long mtime_nsec(const struct stat& st) {return st.st_mtim.tv_nsec;}
+static long ctime_nsec(const struct stat& st) {return st.st_ctim.tv_nsec;}
+#else
+static long mtime_nsec(const struct stat&) {return 0;}
+static long ctime_nsec(const struct stat&) {return 0;}
+#endif
+
+
+void ResultCache::Entry::setStatus(const struct stat& st) {
+   size = st.st_size;
+   mtime = st.st_mtime;
+   mtime_nsec = ::mtime_nsec(st);
+   ctime = st.st_ctime;
+   ctime_nsec = ::ctime_nsec(st);
+}
+
+
+bool ResultCache::Entry::sameStatus(const struct stat& st) const {
+   return (size == st.st_size) && (mtime == st.st_mtime) && (mtime_nsec == ::mtime_nsec(st)) && 
+     (ctime == st.st_ctime) && (ctime_nsec == ::ctime_nsec(st));
+}
+
+
+static bool read_u64(FILE *f, unsigned long long& v) {
+   return fread(&v, sizeof(v), 1, f) == 1;
+}
+
+static bool read_u32(FILE *f, unsigned int& v) {
+   return fread(&v, sizeof(v), 1, f) == 1;
+}
+
+static bool read_str(FILE *f, tstring& s) {
+   unsigned int n;
+   if(!read_u32(f, n)) return false;
+   if(n > 0x10000000) return false; // corrupt
+   char *buf = new char[n];
+   bool ok = fread(buf, 1, n, f) == n;
+   if(ok) s = tstring(buf, n);
+   delete[] buf;
+   return ok;
+}
+
+static void write_u64(FILE *f, unsigned long long v) {
+   fwrite(&v, sizeof(v), 1, f);
+}
+
+static void write_u32(FILE *f, unsigned int v) {
+   fwrite(&v, sizeof(v), 1, f);
+}
+
+static void write_str(FILE *f, const tstring& s) {
+   write_u32(f, s.len());
+   fwrite(s.c_str(), 1, s.len(), f);
+}
+
+
+ResultCache::ResultCache(const tstring& fname_, const tstring& signature_):
+fname(fname_), signature(signature_), modified(false) {
+   pthread_mutex_init(&mutex, 0);
+   
+   FILE *f = fopen(fname.c_str(), "rb");
+   if(f == 0) return; // no cache yet
+   
+   // check magic and signature, else the cache is rebuilt
+   tstring head = tstring(MAGIC) + signature + "\n";
+   char *buf = new char[head.len()];
+   bool ok = (fread(buf, 1, head.len(), f) == head.len()) && (memcmp(buf, head.c_str(), head.len()) == 0);
+   delete[] buf;
+   
+   // read records
+   while(ok) {
+      unsigned long long dev, ino, size, mtime, mtime_ns, ctime, ctime_ns;
+      unsigned int err, flags;
+      Entry e;
+      if(!read_u64(f, dev)) break; // end of file
+      ok = read_u64(f, ino) && read_u64(f, size) && read_u64(f, mtime) && read_u64(f, mtime_ns) && 
+	read_u64(f, ctime) && read_u64(f, ctime_ns) &&
+	read_u32(f, err) && read_u32(f, flags) && read_str(f, e.name) && read_str(f, e.text);
+      if(!ok) {
+	 userWarning("ignoring corrupt cache file '%s'\n", fname.c_str());
+	 entries.clear();
+	 break;
+      }
+      e.size = size;
+      e.mtime = mtime;
+      e.mtime_nsec = mtime_ns;
+      e.ctime = ctime;
+      e.ctime_nsec = ctime_ns;
+      e.err = err;
+      e.ano = flags & 1;
+      e.log = (flags & 2) != 0;
+      entries[Key(TFileInstance(dev, ino), e.name)] = e;
+   }
+   fclose(f);
+}
+
+
+ResultCache::~ResultCache() {
+   pthread_mutex_destroy(&mutex);
+}
+
+
+bool ResultCache::lookup(const TFileInstance& inst, const tstring& name, const struct stat& st, Entry& e) {
+   pthread_mutex_lock(&mutex);
+   tmap<Key, Entry>::iterator i = entries.find(Key(inst, name));
+   bool found = false;
+   if(i != entries.end()) {
+      if(i->second.sameStatus(st)) {
+	 found = true;
+	 i->second.seen = true;
+	 e = i->second;
+      } else {
+	 // stale, the file changed
+	 entries.erase(i);
+	 modified = true;
+      }
+   }
+   pthread_mutex_unlock(&mutex);
+   return found;
+}
+
+
+void ResultCache::store(const TFileInstance& inst, const Entry& e) {
+   pthread_mutex_lock(&mutex);
+   Entry& n = entries[Key(inst, e.name)];
+   n = e;
+   n.seen = true;
+   modified = true;
+   pthread_mutex_unlock(&mutex);
+}
+
+
+// return true if name is root or a file below the directory root
+static bool below(const tstring& name, const tstring& root) {
+   if(name.len() < root.len()) return false;
+   if(memcmp(name.c_str(), root.c_str(), root.len()) != 0) return false;
+   return (name.len() == root.len()) || (name[root.len()] == '/');
+}
+
+
+void ResultCache::prune(const tvector<tstring>& roots) {
+   pthread_mutex_lock(&mutex);
+   for(tmap<Key, Entry>::iterator i = entries.begin(); i != entries.end(); ) {
+      bool stale = false;
+      if(!i->second.seen) {
+	 for(size_t r = 0; r < roots.size(); r++) {
+	    if(below(i->second.name, roots[r])) {
+	       struct stat st;
+	       if(stat(i->second.name.c_str(), &st) == 0)
+		 stale = TFileInstance(dev_t2mydev_t(st.st_dev), st.st_ino) != i->first.inst;
+	       else
+		 stale = (errno == ENOENT) || (errno == ENOTDIR);
+	       break;
+	    }
+	 }
+      }
+      if(stale) {
+	 entries.erase(i++);
+	 modified = true;
+      } else {
+	 ++i;
+      }
+   }
+   pthread_mutex_unlock(&mutex);
+}
+
+
+void ResultCache::save() {
+   if(!modified) return;
+   
+   // write a new file and replace the old one (the name of the temporary
+   // file is unique, so concurrent runs do not write into the same file)
+   char pid[32];
+   snprintf(pid, sizeof(pid), ".%ld.tmp", (long)getpid());
+   tstring tmpname = fname + pid;
+   FILE *f = fopen(tmpname.c_str(), "wb");
+   if(f == 0) {
+      perror("fopen");
+      userError("can't open cache file '%s' for writing!\n", tmpname.c_str());
+   }
+   fputs(MAGIC, f);
+   fputs(signature.c_str(), f);
+   fputs("\n", f);
+   for(tmap<Key, Entry>::const_iterator i = entries.begin(); i != entries.end(); ++i) {
+      const Entry& e = i->second;
+      write_u64(f, i->first.inst.device);
+      write_u64(f, i->first.inst.inode);
+      write_u64(f, e.size);
+      write_u64(f, e.mtime);
+      write_u64(f, e.mtime_nsec);
+      write_u64(f, e.ctime);
+      write_u64(f, e.ctime_nsec);
+      write_u32(f, e.err);
+      write_u32(f, (e.ano ? 1 : 0) | (e.log ? 2 : 0));
+      write_str(f, e.name);
+      write_str(f, e.text);
+   }
+   // the data must be on the disk before the rename
+   if((fflush(f) != 0) | (fsync(fileno(f)) != 0) | ferror(f) | fclose(f)) {
+      perror("fclose");
+      unlink(tmpname.c_str());
+      userError("error while writing cache file '%s'!\n", tmpname.c_str());
+   }
+   if(rename(tmpname.c_str(), fname.c_str())) {
+      perror("rename");
+      userError("can't replace cache file '%s'!\n", fname.c_str());
+   }
+   modified = false;
+}
+
@@ -0,0 +1,114 @@
+/*GPL*START*
+ *
+ * cache of check results header file
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#ifndef _resultcache_h_
+#define _resultcache_h_
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <pthread.h>
+#include "tstring.h"
+#include "tvector.h"
+#include "tmap.h"
+#include "tfiletools.h"
+
+// 2026:
+// 16 Oct  started
+// 16 Oct  key by name too, ctime and nanoseconds, drop entries of files not seen
+// 16 Oct  keep entries of files not seen, only drop entries known to be stale
+
+
+// results of checked files, loaded from and saved to a cache file
+// the cache is keyed by device, inode and name (the paths of a file with
+// several hard links have their own entries), an entry is only valid as
+// long as size, mtime and ctime of the file do not change
+// entries of files which were not seen by a run are kept (a run may check
+// only some of the files), stale entries are dropped: entries of changed
+// files on lookup and entries of deleted files below walked directories
+// by prune()
+class ResultCache {
+ public:
+   // cached result of one file
+   struct Entry {
+      Entry(): size(0), mtime(0), mtime_nsec(0), ctime(0), ctime_nsec(0), err(0), ano(false), log(false), seen(false) {}
+      tstring name;   // name of the file (the messages contain it)
+      off_t size;     // size of the file
+      time_t mtime;   // modification time of the file
+      long mtime_nsec;
+      time_t ctime;   // status change time of the file
+      long ctime_nsec;
+      int err;        // number of errors
+      bool ano;       // anomaly found
+      bool log;       // print name to log file
+      tstring text;   // all messages
+      bool seen;      // found or stored by this run (not saved)
+      
+      // take size and times from st
+      void setStatus(const struct stat& st);
+      // return true if size and times are those of st
+      bool sameStatus(const struct stat& st) const;
+   };
+   
+   // load cache file fname, entries are only used if the cache
+   // was written with the same signature (version and options)
+   ResultCache(const tstring& fname, const tstring& signature);
+   ~ResultCache();
+   
+   // return true and the entry if the file is in the cache and unchanged
+   // (st: status of the file), the entry of a changed file is removed
+   bool lookup(const TFileInstance& inst, const tstring& name, const struct stat& st, Entry& e);
+   // add or replace the entry of file e.name
+   void store(const TFileInstance& inst, const Entry& e);
+   // remove the entries not seen by this run below the directories roots
+   // whose name does not exist anymore or is another file now
+   void prune(const tvector<tstring>& roots);
+   // write the cache file (if anything changed): a temporary file is
+   // written and renamed, so a crash never leaves a corrupt cache
+   void save();
+   
+ private:
+   // forbid copy
+   ResultCache(const ResultCache&);
+   const ResultCache& operator=(const ResultCache&);
+   
+   // key of an entry
+   struct Key {
+      Key(const TFileInstance& inst_, const tstring& name_): inst(inst_), name(name_) {}
+      TFileInstance inst;
+      tstring name;
+      bool operator<(const Key& k) const {
+	 if(inst < k.inst) return true;
+	 if(k.inst < inst) return false;
+	 return name < k.name;
+      }
+   };
+   
+   tstring fname;
+   tstring signature;
+   tmap<Key, Entry> entries;
+   bool modified;
+   pthread_mutex_t mutex;
+};
+
+
+#endif
@@ -0,0 +1,118 @@
+/*GPL*START*
+ *
+ * window onto the data of a file
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+#include "streamwindow.h"
+#include "tappconfig.h"
+
+
+StreamWindow::StreamWindow(const unsigned char *data, off_t len_):
+buf(data), mem(0), size(len_), start(0), stop(len_), len(len_), lookahead(0), fd(-1), pipe(false), name(0) {
+}
+
+
+StreamWindow::StreamWindow(int fd_, off_t len_, size_t size_, const char *name_):
+buf(0), mem(new unsigned char[size_]), size(size_), start(0), stop(0), len(len_), lookahead(0), fd(fd_), pipe(false), name(name_) {
+   buf = mem;
+   if(len == UNKNOWN_LENGTH) {
+      pipe = true;
+      lookahead = PIPE_LOOKAHEAD;
+   }
+}
+
+
+StreamWindow::~StreamWindow() {
+   delete[] mem;
+}
+
+
+const unsigned char *StreamWindow::fill(off_t pos, off_t& avail) {
+   if((fd < 0) || (pos < 0) || (pos > len) || (pipe && (pos < start))) 
+     userError("internal error: StreamWindow::fill: position %lld out of range (window %lld-%lld)!\n", 
+	       (long long)pos, (long long)start, (long long)stop);
+
+   // keep the bytes before pos which are already in the window
+   off_t newstart = pos - KEEP_BEHIND;
+   if(newstart < start) newstart = pipe ? start : ((newstart < 0) ? 0 : newstart);
+   if((newstart >= start) && (newstart < stop)) {
+      memmove(mem, mem + (newstart - start), stop - newstart);
+   } else if(pipe) {
+      // skip data up to newstart
+      while(stop < newstart) {
+	 start = stop;
+	 if(!read((newstart - stop < (off_t)size) ? newstart : stop + size)) break;
+      }
+      if(newstart > stop) newstart = stop;
+   } else {
+      stop = newstart;
+   }
+   start = newstart;
+   
+   // read up to the end of the window or of the file
+   off_t end = start + size;
+   if(end > len) end = len;
+   read(end);
+   if(pos > stop) pos = stop;
+   
+   avail = stop - pos;
+   return buf + (pos - start);
+}
+
+
+bool StreamWindow::read(off_t end) {
+   while(stop < end) {
+      ssize_t r;
+      if(pipe) r = ::read(fd, mem + (stop - start), end - stop);
+      else     r = pread(fd, mem + (stop - start), end - stop, stop);
+      if(pipe && (r == 0)) {
+	 // end of pipe
+	 len = stop;
+	 return false;
+      }
+      if(r <= 0) {
+	 perror(pipe ? "read" : "pread");
+	 userError("error while reading file '%s'!\n", name);
+      }
+      stop += r;
+   }
+   return true;
+}
+
+
+StreamWindow *StreamWindow::twin() const {
+   if(pipe) userError("internal error: StreamWindow::twin: pipes can not be read twice!\n");
+   if(fd < 0) return new StreamWindow(buf, len);
+   return new StreamWindow(fd, len, size, name);
+}
+
+
+void StreamWindow::finish() {
+   if(!pipe) return;
+   while(!lengthKnown()) {
+      start = stop;
+      read(stop + size);
+   }
+   start = stop;
+}
+
@@ -0,0 +1,108 @@
+/*GPL*START*
+ *
+ * window onto the data of a file header file
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#ifndef _streamwindow_h_
+#define _streamwindow_h_
+
+#include <sys/types.h>
+#include <stddef.h>
+
+// 2026:
+// 16 Oct  started: complete data or sliding window filled with pread()
+// 16 Oct  pipes: sequential read() and length unknown until the end
+// 16 Oct  twin() for reading several parts in parallel
+
+
+// view onto the data of a file: either the complete data (mmap or read)
+// or a sliding window of fixed size which is refilled on demand, so
+// the memory usage does not depend on the file size
+// pipes are read sequentially: only the data in the window is accessible
+class StreamWindow {
+ public:
+   // number of bytes kept before the requested position when the window moves
+   enum {KEEP_BEHIND = 4096};
+   // pipes: number of bytes read ahead of the requested ones, so the end
+   // (and with it any trailing tag) is known before it is reached
+   enum {PIPE_LOOKAHEAD = 64*1024};
+   // length of a pipe until its end is reached
+   static const off_t UNKNOWN_LENGTH = ((off_t)1) << 62;
+   
+   // complete data in memory
+   StreamWindow(const unsigned char *data, off_t len);
+   // sliding window of size bytes over file fd of length len
+   // or over pipe fd if len is UNKNOWN_LENGTH
+   StreamWindow(int fd, off_t len, size_t size, const char *name);
+   ~StreamWindow();
+   
+   // return pointer to byte pos and the number of bytes available from
+   // there in avail (at least n, unless the end of the data or the size
+   // of the window is reached)
+   // the pointer is valid up to the next call
+   const unsigned char *data(off_t pos, off_t n, off_t& avail) {
+      if((pos >= start) && ((pos + n + lookahead <= stop) || (stop == len))) {
+	 avail = stop - pos;
+	 return buf + (pos - start);
+      }
+      return fill(pos, avail);
+   }
+   
+   // length of the data (UNKNOWN_LENGTH for pipes until the end is reached)
+   off_t length() const { return len; }
+   bool lengthKnown() const { return len != UNKNOWN_LENGTH; }
+   
+   // first accessible position (pipes can not go back behind the window)
+   off_t first() const { return pipe ? start : 0; }
+   
+   // pipes: read and discard everything up to the end
+   void finish();
+   
+   // false for pipes
+   bool seekable() const { return !pipe; }
+   
+   // return a new independent window onto the same data (not for pipes),
+   // so different threads can read different parts
+   StreamWindow *twin() const;
+   
+ private:
+   // forbid copy
+   StreamWindow(const StreamWindow&);
+   const StreamWindow& operator=(const StreamWindow&);
+   
+   // move window to contain pos
+   const unsigned char *fill(off_t pos, off_t& avail);
+   // read into the window up to end, return false at the end of the pipe
+   bool read(off_t end);
+   
+   const unsigned char *buf;  // data of the window
+   unsigned char *mem;        // allocated window or 0
+   size_t size;               // size of the window
+   off_t start;               // file offset of buf[0]
+   off_t stop;                // file offset behind the last byte in buf
+   off_t len;                 // length of the file
+   off_t lookahead;           // PIPE_LOOKAHEAD for pipes, else 0
+   int fd;                    // file or -1 for complete data
+   bool pipe;                 // fd is not seekable
+   const char *name;          // file name for error messages
+};
+
+
+#endif
@@ -0,0 +1,90 @@
+/*GPL*START*
+ *
+ * fast search for audio mpeg sync words
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#include "syncscan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define HAVE_X86_SIMD
+# include <immintrin.h>
+#endif
+
+
+// plain version, one byte at a time
+static size_t find_sync_scalar(const unsigned char *p, size_t n) {
+   for(size_t i = 0; i < n; i++)
+     if((p[i] == 0xff) && ((p[i+1] & 0xe0) == 0xe0)) return i;
+   return n;
+}
+
+
+#ifdef HAVE_X86_SIMD
+// 16 bytes at a time: compare p[i..i+15] with 0xff and p[i+1..i+16] masked with 0xe0
+__attribute__((target("sse2")))
+static size_t find_sync_sse2(const unsigned char *p, size_t n) {
+   const __m128i ff = _mm_set1_epi8((char)0xff);
+   const __m128i e0 = _mm_set1_epi8((char)0xe0);
+   size_t i = 0;
+   for(; i + 16 <= n; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(p + i));
+      __m128i b = _mm_loadu_si128((const __m128i *)(p + i + 1));
+      __m128i m = _mm_and_si128(_mm_cmpeq_epi8(a, ff), _mm_cmpeq_epi8(_mm_and_si128(b, e0), e0));
+      unsigned int mask = _mm_movemask_epi8(m);
+      if(mask) return i + __builtin_ctz(mask);
+   }
+   return i + find_sync_scalar(p + i, n - i);
+}
+
+
+// 32 bytes at a time
+__attribute__((target("avx2")))
+static size_t find_sync_avx2(const unsigned char *p, size_t n) {
+   const __m256i ff = _mm256_set1_epi8((char)0xff);
+   const __m256i e0 = _mm256_set1_epi8((char)0xe0);
+   size_t i = 0;
+   for(; i + 32 <= n; i += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + 1));
+      __m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(a, ff), _mm256_cmpeq_epi8(_mm256_and_si256(b, e0), e0));
+      unsigned int mask = _mm256_movemask_epi8(m);
+      if(mask) return i + __builtin_ctz(mask);
+   }
+   return i + find_sync_sse2(p + i, n - i);
+}
+#endif
+
+
+// select the fastest version supported by this cpu
+typedef size_t (*find_sync_func)(const unsigned char *p, size_t n);
+static find_sync_func select_find_sync() {
+#ifdef HAVE_X86_SIMD
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("avx2")) return find_sync_avx2;
+   if(__builtin_cpu_supports("sse2")) return find_sync_sse2;
+#endif
+   return find_sync_scalar;
+}
+static const find_sync_func find_sync = select_find_sync();
+
+
+size_t find_sync_candidate(const unsigned char *p, size_t n) {
+   return find_sync(p, n);
+}
@@ -0,0 +1,36 @@
+/*GPL*START*
+ *
+ * fast search for audio mpeg sync words header file
+ * 
+ * Copyright (C) 2026 by the mp3check contributors (see the git history)
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * *GPL*END*/  
+
+#ifndef _syncscan_h_
+#define _syncscan_h_
+
+#include <stddef.h>
+
+// 2026:
+// 16 Oct  started: sse2 and avx2 versions with scalar fallback, selected at runtime
+
+// return the first position i < n with p[i] == 0xff and the upper 3 bits
+// of p[i+1] set (possible sync word), or n if there is none
+// (p[n] must be readable)
+size_t find_sync_candidate(const unsigned char *p, size_t n);
+
+#endif
@@ -21,6 +21,7 @@
 
 #include <sys/types.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include "tfiletools.h"
 
 #define COUNT_VERBOSE_STEP 1000
@@ -166,6 +167,250 @@ bool TDir::no_leaf_optimize = false;
 #endif
 
 
+// TDirWalker implementation
+// 
+TDirWalker::TDirWalker(const TFile& root, const TSubTreeContext& context, int nthreads): 
+top(0), ahead(0), quit(false), threads(nthreads), 
+root_device(root.device()), cross_filesystems(context.cross_filesystems), max_depth(context.max_depth) {
+    if(nthreads == 0) {
+	// the root is the only subdirectory of an empty top level
+	Level l;
+	l.dirs.push_back(root.name());
+	path.push_back(l);
+	return;
+    }
+    top = new Node(tstring(), tstring(), 0);
+    top->state = Node::DONE;
+    top->dirs.push_back(new Node(root.name(), tstring(), 0));
+    todo[tstring()] = top->dirs[0];
+    visits.push_back(Visit(top));
+    pthread_mutex_init(&mutex, 0);
+    pthread_cond_init(&cond, 0);
+    for(int i = 0; i < nthreads; i++)
+	if(pthread_create(&threads[i], 0, thread, this)) {
+	    // next() reads the directories itself if there are no threads
+	    threads.erase(threads.begin() + i, threads.end());
+	    break;
+	}
+}
+
+TDirWalker::~TDirWalker() {
+    for(size_t i = 0; i < path.size(); i++)
+	if(path[i].dir) closedir(path[i].dir);
+    if(top) {
+	pthread_mutex_lock(&mutex);
+	quit = true;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+	for(size_t i = 0; i < threads.size(); i++)
+	    pthread_join(threads[i], 0);
+	delete top;
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+    }
+}
+
+bool TDirWalker::openDir(const tstring& dname, size_t depth, DIR *& dir, size_t& dirs_left) const {
+    dir = 0;
+    // maximum depth already reached? if so treat directory as empty
+    if(depth >= max_depth) return true;
+    dir = opendir(dname.c_str());
+    if(dir == 0) return false;
+    // the open directory tells its device and number of subdirectories
+    struct stat st;
+    if(fstat(dirfd(dir), &st) == 0) {
+	// prevent crossing filesystems? consider directory empty
+	if(!cross_filesystems && (dev_t2mydev_t(st.st_dev) != root_device)) {
+	    closedir(dir);
+	    dir = 0;
+	}
+	dirs_left = st.st_nlink - 2;
+    } else {
+	dirs_left = ~size_t(0);
+    }
+    return true;
+}
+
+bool TDirWalker::isDir(DIR *dir, struct dirent *de, size_t& dirs_left, bool& stated, struct stat& st) const {
+    bool isdir = false;
+    bool known = false;
+    stated = false;
+# ifdef _DIRENT_HAVE_D_TYPE
+    // the type from the directory entry saves the stat of each file
+    if((de->d_type != DT_UNKNOWN) && !((de->d_type == DT_LNK) && TFile::follow_links)) {
+	isdir = de->d_type == DT_DIR;
+	known = true;
+    }
+# endif
+    if(!known && (dirs_left || TDir::no_leaf_optimize)) {
+	// stat relative to the open directory, a vanished file is left to the caller
+	if(fstatat(dirfd(dir), de->d_name, &st, TFile::follow_links ? 0 : AT_SYMLINK_NOFOLLOW) == 0) {
+	    isdir = S_ISDIR(st.st_mode);
+	    // the status of a symbolic link is not the status of the file
+	    stated = !S_ISLNK(st.st_mode) && !isdir;
+	}
+    }
+    if(isdir) dirs_left--;
+    return isdir;
+}
+
+bool TDirWalker::next(tstring& fname, bool& stated, struct stat& st) {
+    if(top) return nextParallel(fname, stated, st);
+    else    return nextSerial(fname, stated, st);
+}
+
+bool TDirWalker::enter(const tstring& dname, size_t depth) {
+    Level l;
+    l.name = dname;
+    l.depth = depth;
+    if(!openDir(dname, depth, l.dir, l.dirs_left)) return false;
+    path.push_back(l);
+    return true;
+}
+
+bool TDirWalker::nextSerial(tstring& fname, bool& stated, struct stat& st) {
+    stated = false;
+    while(!path.empty()) {
+	Level& l = path.back();
+	if(l.dir) {
+	    // files of the current directory
+	    struct dirent *dire = readdir(l.dir);
+	    if(dire == 0) {
+		closedir(l.dir);
+		l.dir = 0;
+		continue;
+	    }
+	    if((dire->d_name[0] == '.') && (!strcmp(".", dire->d_name) || !strcmp("..", dire->d_name)))
+		continue;
+	    if(isDir(l.dir, dire, l.dirs_left, stated, st)) {
+		l.dirs.push_back((l.name + "/") + dire->d_name);
+		continue;
+	    }
+	    fname = (l.name + "/") + dire->d_name;
+	    return true;
+	}
+	if(l.next_dir < l.dirs.size()) {
+	    // subdirectories
+	    tstring d = l.dirs[l.next_dir++];
+	    // the root is at depth 0
+	    if(!enter(d, path.size() - 1)) {
+		fname = d;
+		return true;
+	    }
+	    continue;
+	}
+	path.pop_back();
+    }
+    return false;
+}
+
+void TDirWalker::read(Node *n) {
+    DIR *dir;
+    size_t dirs_left = 0;
+    if(!openDir(n->name, n->depth, dir, dirs_left)) {
+	n->failed = true;
+	return;
+    }
+    if(dir == 0) return;
+    struct dirent *dire;
+    while((dire = readdir(dir)) != 0) {
+	if((dire->d_name[0] == '.') && (!strcmp(".", dire->d_name) || !strcmp("..", dire->d_name)))
+	    continue;
+	Entry e;
+	e.name = (n->name + "/") + dire->d_name;
+	if(isDir(dir, dire, dirs_left, e.stated, e.st)) {
+	    // fixed width indices sort in the order of the walk
+	    char index[32];
+	    snprintf(index, sizeof(index), "%08lx", (unsigned long)n->dirs.size());
+	    n->dirs.push_back(new Node(e.name, n->key + index, n->depth + 1));
+	} else
+	    n->files.push_back(e);
+    }
+    closedir(dir);
+}
+
+void TDirWalker::done(Node *n) {
+    n->state = Node::DONE;
+    for(size_t i = 0; i < n->dirs.size(); i++)
+	todo[n->dirs[i]->key] = n->dirs[i];
+    pthread_cond_broadcast(&cond);
+}
+
+void *TDirWalker::thread(void *arg) {
+    TDirWalker& w = *(TDirWalker *)arg;
+    pthread_mutex_lock(&w.mutex);
+    for(;;) {
+	while(!w.quit && (w.todo.empty() || (w.ahead >= MAX_AHEAD)))
+	    pthread_cond_wait(&w.cond, &w.mutex);
+	if(w.quit) break;
+	// the directory needed first by the walk
+	Node *n = w.todo.begin()->second;
+	w.todo.erase(w.todo.begin());
+	n->state = Node::READING;
+	n->ahead = true;
+	w.ahead++;
+	pthread_mutex_unlock(&w.mutex);
+	w.read(n);
+	pthread_mutex_lock(&w.mutex);
+	w.done(n);
+    }
+    pthread_mutex_unlock(&w.mutex);
+    return 0;
+}
+
+bool TDirWalker::nextParallel(tstring& fname, bool& stated, struct stat& st) {
+    // a directory is only walked when it is done, its files and subdirectories
+    // do not change any more
+    stated = false;
+    for(;;) {
+	Visit& v = visits.back();
+	Node *n = v.node;
+	if(v.next_file < n->files.size()) {
+	    // files of the current directory
+	    const Entry& e = n->files[v.next_file++];
+	    fname = e.name;
+	    stated = e.stated;
+	    if(stated) st = e.st;
+	    return true;
+	}
+	if(v.next_dir < n->dirs.size()) {
+	    // subdirectories: wait until read, or read it here if not yet taken
+	    Node *d = n->dirs[v.next_dir++];
+	    pthread_mutex_lock(&mutex);
+	    if(d->state == Node::QUEUED) {
+		todo.erase(d->key);
+		d->state = Node::READING;
+		pthread_mutex_unlock(&mutex);
+		read(d);
+		pthread_mutex_lock(&mutex);
+		done(d);
+	    }
+	    while(d->state != Node::DONE)
+		pthread_cond_wait(&cond, &mutex);
+	    if(d->ahead) {
+		ahead--;
+		pthread_cond_broadcast(&cond);
+	    }
+	    pthread_mutex_unlock(&mutex);
+	    if(d->failed) {
+		fname = d->name;
+		delete d;
+		n->dirs[v.next_dir - 1] = 0;
+		return true;
+	    }
+	    visits.push_back(Visit(d));
+	    continue;
+	}
+	// directory done: free it (top is freed by the destructor)
+	if(visits.size() == 1) return false;
+	visits.pop_back();
+	Visit& p = visits.back();
+	p.node->dirs[p.next_dir - 1] = 0;
+	delete n;
+    }
+}
+
+
 // global functions
 tvector<tstring> findFilesRecursive(const TDir& dir) {
     // return value
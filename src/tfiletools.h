@@ -25,6 +25,8 @@
 # include <sys/stat.h>
 # include <sys/types.h>
 # include <unistd.h>
+# include <dirent.h>
+# include <pthread.h>
 # include <assert.h>
 # include "tstring.h"
 # include "texception.h"
@@ -36,6 +38,9 @@
 // 25 Jun 2001: created (Dir and File taken from filesync.cc)
 // 
 // 2007 24 Oct: removed __STRICT_ANSI__ support, fixed dev_t and made it more robust, fixed operator < for TFileInstance
+// 2026 16 Oct: added TDirWalker
+// 2026 16 Oct: TDirWalker: use d_type and fstatat() instead of a stat() per file
+// 2026 16 Oct: TDirWalker: read directories ahead with threads, honor TSubTreeContext
 
 
 // own device type which is a simple 64 bit unsigned integer
@@ -138,6 +143,7 @@ private:
     // private static data
     static bool follow_links;
     static size_t num_stated;
+    friend class TDirWalker;
     
     // forbid implicit comparison
     bool operator==(const TFile&);
@@ -202,11 +208,107 @@ private:
     static size_t verbose_num;
     static size_t old_verbose_num;
     static bool no_leaf_optimize;
+    friend class TDirWalker;
     
     // forbid implicit comparison
     bool operator==(const TDir&);
 };
 
+// walk a directory tree depth first and return one file at a time, in the 
+// same order as findFilesRecursive() but without building the tree: only the
+// directories on the current path with their subdirectories not yet visited
+// are kept in memory
+// files are only stat'ed if the file system does not report the file type
+// in the directory entry (d_type)
+// with threads, the directories are read ahead in parallel (for file systems
+// with a high latency like NFS) and kept in memory until they are walked
+class TDirWalker {
+public:
+    // the cross_filesystems and max_depth rules of context apply
+    TDirWalker(const TFile& root, const TSubTreeContext& context, int threads = 0);
+    ~TDirWalker();
+    
+    // get the name of the next file, return false at the end of the tree
+    // (a directory which cannot be read is returned like a file)
+    // stated: st is the status of the file (if it had to be stat'ed anyway)
+    bool next(tstring& fname, bool& stated, struct stat& st);
+    
+    // maximum number of directories read ahead by the threads
+    enum {MAX_AHEAD = 256};
+    
+private:
+    // open directory dname at depth for reading, return false if it cannot 
+    // be read, dir is 0 if the directory is to be treated as empty
+    bool openDir(const tstring& dname, size_t depth, DIR *& dir, size_t& dirs_left) const;
+    // whether entry de of dir is a directory, stated: see next()
+    bool isDir(DIR *dir, struct dirent *de, size_t& dirs_left, bool& stated, struct stat& st) const;
+    
+    // serial walk: files are returned while their directory is read
+    struct Level {
+	Level(): depth(0), dir(0), dirs_left(0), next_dir(0) {}
+	tstring name;
+	size_t depth;
+	DIR *dir;              // open while the files are returned
+	size_t dirs_left;      // subdirectories not yet found (leaf optimization)
+	tvector<tstring> dirs; // subdirectories, visited after all files
+	size_t next_dir;
+    };
+    // start reading directory dname, return false if it cannot be read
+    bool enter(const tstring& dname, size_t depth);
+    bool nextSerial(tstring& fname, bool& stated, struct stat& st);
+    tvector<Level> path;
+    
+    // parallel walk: the threads take the directories from a shared queue,
+    // in the order in which the walk needs them, and read them completely,
+    // next() reads a directory itself if no thread has taken it yet
+    struct Entry {
+	tstring name;
+	bool stated;
+	struct stat st;
+    };
+    struct Node {
+	enum State {QUEUED, READING, DONE};
+	Node(const tstring& n, const tstring& k, size_t d): name(n), key(k), depth(d), state(QUEUED), failed(false), ahead(false) {}
+	~Node() { for(size_t i = 0; i < dirs.size(); i++) delete dirs[i]; }
+	tstring name;
+	tstring key;           // position in the walk: indices of the subdirectories on the path
+	size_t depth;
+	State state;
+	bool failed;           // cannot be read
+	bool ahead;            // read by a thread
+	tvector<Entry> files;
+	tvector<Node*> dirs;   // subdirectories, owned until they are walked
+    };
+    struct Visit {
+	Visit(Node *n = 0): node(n), next_file(0), next_dir(0) {}
+	Node *node;
+	size_t next_file;
+	size_t next_dir;
+    };
+    // read directory n (without lock)
+    void read(Node *n);
+    // n has been read: queue its subdirectories (with lock)
+    void done(Node *n);
+    static void *thread(void *arg);
+    bool nextParallel(tstring& fname, bool& stated, struct stat& st);
+    tvector<Visit> visits;
+    Node *top;                 // the root is the only subdirectory of top
+    tmap<tstring,Node*> todo;  // directories not yet taken, by key
+    size_t ahead;              // directories read by the threads, not yet walked
+    bool quit;
+    tvector<pthread_t> threads;
+    pthread_mutex_t mutex;     // protects todo, ahead, quit and Node::state
+    pthread_cond_t cond;       // signalled whenever a directory is read or walked
+    
+    mydev_t root_device;
+    bool cross_filesystems;
+    size_t max_depth;
+    
+    // forbid copy
+    TDirWalker(const TDirWalker&);
+    const TDirWalker& operator=(const TDirWalker&);
+};
+
 // global functions
 tvector<tstring> findFilesRecursive(const TDir& dir);
 tvector<tstring> filterExtensions(const tvector<tstring>& list, const tvector<tstring>& extensions, bool remove = false);
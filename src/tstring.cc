@@ -89,6 +89,9 @@
 // 2006:
 // 27 Jul: palmos support removed
 
+// 2026:
+// 16 Oct: reference counting made atomic (mp3check --jobs shares strings between threads)
+
 
 // global static null and zero rep members
 tstring::Rep* tstring::Rep::nul = 0;
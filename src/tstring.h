@@ -60,10 +60,10 @@ class tstring {
       char *data() {return (char *)(this + 1);} // 'this + 1' means 'the byte following this object'
       // character access
       char& operator[] (size_t i) {return data()[i];}
-      // reference
-      Rep* grab() {if(vulnerable) return clone(); ++ref; return this;}
+      // reference (atomic, strings may be shared between threads)
+      Rep* grab() {if(vulnerable) return clone(); __sync_add_and_fetch(&ref, 1); return this;}
       // dereference
-      void release() {if(--ref == 0) delete this;}
+      void release() {if(__sync_sub_and_fetch(&ref, 1) == 0) delete this;}
       // copy this representation
       Rep *clone(size_t minmem = 0);
       // terminate string with 0 byte